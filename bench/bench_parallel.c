@@ -0,0 +1,95 @@
+// Compares json_parse_string with json_parse_string_parallel on a large
+// synthetic get_books listing, for 1, 2, 4, ... threads up to the number of
+// online cores (or the number given on the command line).
+// Usage: bench_parallel [number_of_books] [rounds] [max_threads]
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "parson.h"
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char *build_listing(int books)
+{
+    size_t cap = (size_t)books * 128 + 16;
+    char *listing = malloc(cap);
+    size_t len = 0;
+
+    listing[len++] = '[';
+    for (int i = 0; i < books; i++) {
+        len += snprintf(listing + len, cap - len,
+                        "%s{\"id\":%d,\"title\":\"Book number %d\",\"author\":\"Author %d\",\"page_count\":%d}",
+                        i ? "," : "", i + 1, i + 1, i % 97, 100 + i % 900);
+    }
+    listing[len++] = ']';
+    listing[len] = '\0';
+
+    return listing;
+}
+
+static double checksum(JSON_Value *root)
+{
+    JSON_Array *books = json_value_get_array(root);
+    size_t count = json_array_get_count(books);
+    double sum = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        sum += json_object_get_number(json_array_get_object(books, i), "id") * (i + 1);
+    }
+
+    return sum;
+}
+
+static double bench(const char *listing, int rounds, unsigned int threads, double *sum)
+{
+    double total = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        double start = now_ms();
+        JSON_Value *root = threads ? json_parse_string_parallel(listing, threads)
+                                   : json_parse_string(listing);
+        total += now_ms() - start;
+        *sum = checksum(root);
+        json_value_free(root);
+    }
+
+    return total / rounds;
+}
+
+int main(int argc, char *argv[])
+{
+    int books = argc > 1 ? atoi(argv[1]) : 500000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 5;
+    long cores = argc > 3 ? atol(argv[3]) : sysconf(_SC_NPROCESSORS_ONLN);
+    char *listing = build_listing(books);
+    double expected = 0, sum = 0;
+
+    json_set_key_interning(1);
+    printf("%d books, %zu bytes of JSON, %d rounds, %ld cores\n", books, strlen(listing), rounds, cores);
+
+    double serial = bench(listing, rounds, 0, &expected);
+    printf("json_parse_string:              %8.2f ms\n", serial);
+
+    for (unsigned int threads = 1; threads <= (unsigned long)cores; threads *= 2) {
+        double parallel = bench(listing, rounds, threads, &sum);
+        printf("json_parse_string_parallel(%2u): %8.2f ms  x%.2f\n", threads, parallel, serial / parallel);
+        if (sum != expected) {
+            printf("result differs from json_parse_string\n");
+            return 1;
+        }
+    }
+
+    free(listing);
+    return 0;
+}
@@ -0,0 +1,163 @@
+// Compares the pointer DOM (json_parse_string) with the tape DOM
+// (json_tape_parse_string) on a synthetic get_books listing. The pointer
+// DOM is measured twice, the second time with node pooling enabled.
+// Usage: bench_tape [number_of_books] [rounds]
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "parson.h"
+
+static size_t allocated_bytes = 0;
+static size_t allocation_count = 0;
+
+// every block remembers its size, so frees can be accounted for
+static void *counting_malloc(size_t size)
+{
+    size_t *block = malloc(size + sizeof(size_t));
+    if (!block) {
+        return NULL;
+    }
+
+    block[0] = size;
+    allocated_bytes += size;
+    allocation_count++;
+    return block + 1;
+}
+
+static void counting_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+
+    size_t *block = (size_t *)ptr - 1;
+    allocated_bytes -= block[0];
+    free(block);
+}
+
+static double now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+static char *build_listing(int books)
+{
+    size_t cap = (size_t)books * 64 + 16;
+    char *listing = malloc(cap);
+    size_t len = 0;
+
+    listing[len++] = '[';
+    for (int i = 0; i < books; i++) {
+        len += snprintf(listing + len, cap - len, "%s{\"id\":%d,\"title\":\"Book number %d\"}",
+                        i ? "," : "", i + 1, i + 1);
+    }
+    listing[len++] = ']';
+    listing[len] = '\0';
+
+    return listing;
+}
+
+static double traverse_dom(JSON_Value *root)
+{
+    JSON_Array *books = json_value_get_array(root);
+    size_t count = json_array_get_count(books);
+    double sum = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        JSON_Object *book = json_array_get_object(books, i);
+        sum += json_object_get_number(book, "id");
+        sum += strlen(json_object_get_string(book, "title"));
+    }
+
+    return sum;
+}
+
+static double traverse_tape(const JSON_Tape *tape)
+{
+    const JSON_Tape_Value *books = json_tape_get_root(tape);
+    size_t count = json_tape_array_get_count(books);
+    double sum = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const JSON_Tape_Value *book = json_tape_array_get_object(books, i);
+        sum += json_tape_object_get_number(book, "id");
+        sum += strlen(json_tape_object_get_string(book, "title"));
+    }
+
+    return sum;
+}
+
+static double bench_dom(const char *listing, int rounds, const char *label)
+{
+    double parse_ms = 0, walk_ms = 0, check = 0;
+    size_t memory = 0, allocations = 0;
+
+    for (int r = 0; r < rounds; r++) {
+        double start = now_ms();
+        allocation_count = 0;
+        JSON_Value *root = json_parse_string(listing);
+        double parsed = now_ms();
+        check += traverse_dom(root);
+        double walked = now_ms();
+
+        parse_ms += parsed - start;
+        walk_ms += walked - parsed;
+        memory = allocated_bytes;
+        allocations = allocation_count;
+        json_value_free(root);
+    }
+    printf("%s parse %8.2f ms  traverse %8.2f ms  %9zu bytes in %zu allocations\n",
+           label, parse_ms / rounds, walk_ms / rounds, memory, allocations);
+
+    return check;
+}
+
+int main(int argc, char *argv[])
+{
+    int books = argc > 1 ? atoi(argv[1]) : 50000;
+    int rounds = argc > 2 ? atoi(argv[2]) : 20;
+    char *listing = build_listing(books);
+    double check = 0;
+
+    json_set_allocation_functions(counting_malloc, counting_free);
+    json_set_key_interning(1);
+    printf("%d books, %zu bytes of JSON, %d rounds\n", books, strlen(listing), rounds);
+
+    check = bench_dom(listing, rounds, "pointer DOM:");
+    // after the first round, nodes come back out of the free lists
+    json_set_node_pooling(1);
+    if (bench_dom(listing, rounds, "pooled DOM: ") != check) {
+        return 1;
+    }
+    json_set_node_pooling(0);
+
+    double parse_ms = 0, walk_ms = 0;
+    size_t memory = 0, allocations = 0;
+    for (int r = 0; r < rounds; r++) {
+        double start = now_ms();
+        allocation_count = 0;
+        JSON_Tape *tape = json_tape_parse_string(listing);
+        double parsed = now_ms();
+        check -= traverse_tape(tape);
+        double walked = now_ms();
+
+        parse_ms += parsed - start;
+        walk_ms += walked - parsed;
+        memory = allocated_bytes;
+        allocations = allocation_count;
+        json_tape_free(tape);
+    }
+    printf("tape DOM:    parse %8.2f ms  traverse %8.2f ms  %9zu bytes in %zu allocations\n",
+           parse_ms / rounds, walk_ms / rounds, memory, allocations);
+
+    free(listing);
+    // both walks must have seen the same data
+    return check == 0 ? 0 : 1;
+}
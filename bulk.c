@@ -0,0 +1,772 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <limits.h>
+#include <time.h>
+
+#include "bulk.h"
+#include "functions.h"
+
+// Books read per round of uploads, per request in flight
+#define BATCH_PER_REQUEST 4
+// Times a DELETE is sent at most when the server doesn't answer or fails
+#define DELETE_ATTEMPTS 3
+// Pause before the first retry, doubled for each one after it
+#define RETRY_DELAY_MS 100
+
+static const char *book_fields[BOOK_FIELDS] = {"title", "author", "genre", "publisher", "page_count"};
+
+// A book read from the file, waiting to be uploaded
+typedef struct {
+    size_t line;           // line of the file it was read from
+    JSON_Value *book;      // the book, as add_book would send it; NULL if the record is invalid
+    const char *reason;    // field found invalid, when book is NULL
+} bulk_book;
+
+// One id of a multi-id get_book
+typedef struct {
+    int id;
+    char *message;         // request, NULL when the caches answered
+    char *stale_body;      // copy of the cached book being revalidated, if any
+    flight_result *result; // response, shared with identical requests in flight
+    char *output;          // what to print for the id, once known
+} book_lookup;
+
+// Requests of a multi-id get_book, reported back as they finish
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t finished_one; // signaled whenever a request finishes
+    connection_pool *pool;
+    book_lookup *lookups;
+    size_t *finished;      // indexes of the finished requests, in finishing order
+    size_t finished_count;
+} lookup_batch;
+
+typedef struct {
+    lookup_batch *batch;
+    size_t index;
+} lookup_task_arg;
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void *allocate(size_t count, size_t size)
+{
+    void *memory = calloc(count ? count : 1, size);
+    if (!memory) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    return memory;
+}
+
+static size_t batch_capacity(const bulk_sender *sender)
+{
+    // Enough requests per round to keep every thread's pipeline full a few times
+    size_t threads = sender->engine->thread_count ? sender->engine->thread_count : 1;
+    return threads * (sender->depth ? sender->depth : 1) * BATCH_PER_REQUEST;
+}
+
+static void pipeline_task(void *arg)
+{
+    bulk_pipeline *pipeline = arg;
+
+    // Runs on an engine thread, only the pooled connection is touched
+    pool_pipeline(pipeline->pool, pipeline->messages, pipeline->count, pipeline->responses);
+}
+
+void bulk_send(const bulk_sender *sender, char **messages, char **responses, size_t count)
+{
+    size_t threads = sender->engine->thread_count ? sender->engine->thread_count : 1;
+    size_t depth = sender->depth ? sender->depth : 1;
+
+    // Spread a small batch over every thread rather than filling one pipeline
+    if ((count + threads - 1) / threads < depth) {
+        depth = (count + threads - 1) / threads;
+    }
+
+    size_t pipeline_count = depth ? (count + depth - 1) / depth : 0;
+    bulk_pipeline *pipelines = allocate(pipeline_count, sizeof(bulk_pipeline));
+    memset(responses, 0, count * sizeof(char *));
+
+    engine_group group;
+    engine_group_init(&group);
+    for (size_t i = 0; i < pipeline_count; i++) {
+        size_t first = i * depth;
+        pipelines[i].pool = sender->pool;
+        pipelines[i].messages = messages + first;
+        pipelines[i].responses = responses + first;
+        pipelines[i].count = count - first < depth ? count - first : depth;
+        engine_submit(sender->engine, &group, pipeline_task, &pipelines[i]);
+    }
+    engine_group_wait(&group);
+    engine_group_destroy(&group);
+
+    free(pipelines);
+}
+
+int split_csv_line(char *line, char **fields, int max)
+{
+    char *in = line, *out = line;
+    int count = 0;
+
+    // Fields are unquoted up to the next comma, or quoted with "" standing for a quote
+    while (count < max) {
+        fields[count++] = out;
+
+        if (*in == '"') {
+            in++;
+            while (*in != '"' || in[1] == '"') {
+                if (*in == '\0') {
+                    return -1;
+                }
+                if (*in == '"') {
+                    in++;
+                }
+                *out++ = *in++;
+            }
+            in++;
+        }
+        while (*in != ',' && *in != '\0') {
+            *out++ = *in++;
+        }
+
+        // The field is terminated where it was copied to, which is never past the comma
+        char separator = *in;
+        *out++ = '\0';
+        if (separator != ',') {
+            break;
+        }
+        in++;
+    }
+
+    return count;
+}
+
+static JSON_Value *make_book(const char **strings, double page_count)
+{
+    // Same fields in the same order as the interactive add_book
+    JSON_Value *book = json_value_init_object();
+    JSON_Object *obj = json_value_get_object(book);
+
+    for (int i = 0; i < BOOK_FIELDS - 1; i++) {
+        json_object_set_string(obj, book_fields[i], strings[i]);
+    }
+    json_object_set_number(obj, "page_count", page_count);
+
+    return book;
+}
+
+static int parse_page_count(const char *str, double *page_count)
+{
+    // A plain non-negative integer, like the interactive prompt accepts
+    if (!str || str[0] == '\0' || strlen(str) > 9 || !is_number(str)) {
+        return -1;
+    }
+
+    *page_count = atoi(str);
+    return 0;
+}
+
+JSON_Value *book_from_json(const char *line, const char **reason)
+{
+    JSON_Value *value = json_parse_string(line);
+    JSON_Object *obj = json_value_get_object(value);
+    const char *strings[BOOK_FIELDS - 1];
+    double page_count = -1;
+
+    *reason = "record";
+    if (!obj) {
+        json_value_free(value);
+        return NULL;
+    }
+
+    for (int i = 0; i < BOOK_FIELDS - 1; i++) {
+        strings[i] = json_object_get_string(obj, book_fields[i]);
+        if (!strings[i]) {
+            *reason = book_fields[i];
+            json_value_free(value);
+            return NULL;
+        }
+    }
+
+    // page_count may be a number or a string of digits
+    JSON_Value *pages = json_object_get_value(obj, "page_count");
+    if (json_value_get_type(pages) == JSONNumber) {
+        page_count = json_value_get_number(pages);
+        if (page_count < 0 || page_count > INT_MAX || page_count != (double)(int)page_count) {
+            page_count = -1;
+        }
+    } else if (parse_page_count(json_value_get_string(pages), &page_count) < 0) {
+        page_count = -1;
+    }
+
+    if (page_count < 0) {
+        *reason = "page_count";
+        json_value_free(value);
+        return NULL;
+    }
+
+    JSON_Value *book = make_book(strings, page_count);
+    json_value_free(value);
+    return book;
+}
+
+JSON_Value *book_from_csv(char **fields, int count, const int *columns, const char **reason)
+{
+    const char *strings[BOOK_FIELDS - 1];
+    double page_count;
+
+    for (int i = 0; i < BOOK_FIELDS; i++) {
+        if (columns[i] >= count) {
+            *reason = book_fields[i];
+            return NULL;
+        }
+    }
+
+    for (int i = 0; i < BOOK_FIELDS - 1; i++) {
+        strings[i] = fields[columns[i]];
+    }
+
+    if (parse_page_count(fields[columns[BOOK_FIELDS - 1]], &page_count) < 0) {
+        *reason = "page_count";
+        return NULL;
+    }
+
+    return make_book(strings, page_count);
+}
+
+static int read_csv_header(char *line, int *columns)
+{
+    char *names[64];
+    int count = split_csv_line(line, names, 64);
+
+    // Columns can come in any order, extra ones are ignored
+    for (int i = 0; i < BOOK_FIELDS; i++) {
+        columns[i] = -1;
+        for (int j = 0; j < count; j++) {
+            if (!strcasecmp(names[j], book_fields[i])) {
+                columns[i] = j;
+            }
+        }
+        if (columns[i] < 0) {
+            out_printf("Missing column %s in the CSV header\n", book_fields[i]);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+static int is_csv_file(const char *path, const char *first_line)
+{
+    const char *extension = strrchr(path, '.');
+
+    if (extension && !strcasecmp(extension, ".csv")) {
+        return 1;
+    }
+    if (extension && (!strcasecmp(extension, ".jsonl") || !strcasecmp(extension, ".json") ||
+                      !strcasecmp(extension, ".ndjson"))) {
+        return 0;
+    }
+
+    // Otherwise JSON lines start with an object
+    return first_line[strspn(first_line, " \t")] != '{';
+}
+
+static void upload_batch(bulk_book *books, size_t count, char *token, book_cache *cache,
+                         book_catalog *catalog, const bulk_sender *sender,
+                         size_t *added, size_t *invalid, size_t *failed)
+{
+    char **messages = allocate(count, sizeof(char *));
+    char **responses = allocate(count, sizeof(char *));
+    size_t valid = 0;
+
+    // Only valid records are sent
+    for (size_t i = 0; i < count; i++) {
+        if (books[i].book) {
+            messages[valid++] = build_add_book_request(books[i].book, token);
+        }
+    }
+
+    bulk_send(sender, messages, responses, valid);
+
+    // Report and cache the books in file order
+    for (size_t i = 0, sent = 0; i < count; i++) {
+        if (!books[i].book) {
+            out_printf("line %zu: invalid %s\n", books[i].line, books[i].reason);
+            (*invalid)++;
+            continue;
+        }
+
+        char *response = responses[sent];
+        if (!response) {
+            out_printf("line %zu: no response\n", books[i].line);
+            (*failed)++;
+        } else {
+            cache_added_book(response, books[i].book, cache, catalog);
+            out_printf("line %zu: %.*s\n", books[i].line, (int)strcspn(response, "\r\n"), response);
+            if (http_status(response) / 100 == 2) {
+                (*added)++;
+            } else {
+                (*failed)++;
+            }
+        }
+
+        free(messages[sent]);
+        free(response);
+        json_value_free(books[i].book);
+        sent++;
+    }
+
+    free(messages);
+    free(responses);
+}
+
+void add_books(char *path, char *token, book_cache *cache, book_catalog *catalog,
+               const bulk_sender *sender)
+{
+    if (!token) {
+        out_printf("Cannot add books - invalid or missing token\n");
+        return;
+    }
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        out_printf("Cannot open %s\n", path);
+        return;
+    }
+
+    size_t batch_size = batch_capacity(sender);
+    bulk_book *batch = allocate(batch_size, sizeof(bulk_book));
+    size_t batch_count = 0;
+
+    char *line = NULL;
+    size_t line_size = 0, line_number = 0;
+    size_t added = 0, invalid = 0, failed = 0;
+    int csv = -1, columns[BOOK_FIELDS];
+    double start = now_seconds();
+
+    // The file is streamed, only one batch of books is kept in memory
+    while (getline(&line, &line_size, file) != -1) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if (line[strspn(line, " \t")] == '\0') {
+            continue;
+        }
+
+        // The first line tells the format; for CSV it names the columns
+        if (csv < 0) {
+            csv = is_csv_file(path, line);
+            if (csv && read_csv_header(line, columns) < 0) {
+                break;
+            }
+            if (csv) {
+                continue;
+            }
+        }
+
+        const char *reason = NULL;
+        JSON_Value *book;
+        if (csv) {
+            char *fields[64];
+            int count = split_csv_line(line, fields, 64);
+            book = count < 0 ? NULL : book_from_csv(fields, count, columns, &reason);
+            reason = count < 0 ? "quoting" : reason;
+        } else {
+            book = book_from_json(line, &reason);
+        }
+
+        // Invalid records are reported in their place and skipped, the others still go up
+        batch[batch_count].line = line_number;
+        batch[batch_count].book = book;
+        batch[batch_count].reason = reason;
+        if (++batch_count == batch_size) {
+            upload_batch(batch, batch_count, token, cache, catalog, sender, &added, &invalid, &failed);
+            batch_count = 0;
+        }
+    }
+    upload_batch(batch, batch_count, token, cache, catalog, sender, &added, &invalid, &failed);
+
+    double elapsed = now_seconds() - start;
+    out_printf("Added %zu of %zu books in %.2f s (%.1f books/s), %zu invalid, %zu failed\n",
+           added, added + invalid + failed, elapsed, elapsed > 0 ? added / elapsed : 0.0,
+           invalid, failed);
+
+    free(line);
+    free(batch);
+    fclose(file);
+}
+
+int parse_id_list(const char *spec, int **ids, size_t *count)
+{
+    size_t capacity = 16;
+    const char *p = spec;
+
+    *count = 0;
+    *ids = allocate(capacity, sizeof(int));
+
+    // Ids and ranges like 4-10, separated by commas or spaces
+    while (1) {
+        while (*p == ',' || isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == '\0') {
+            break;
+        }
+
+        char *end;
+        long first = isdigit((unsigned char)*p) ? strtol(p, &end, 10) : -1;
+        long last = first;
+        if (first > 0 && *end == '-' && isdigit((unsigned char)end[1])) {
+            last = strtol(end + 1, &end, 10);
+        }
+
+        if (first <= 0 || last < first || last > INT_MAX ||
+            (*end != '\0' && *end != ',' && !isspace((unsigned char)*end)) ||
+            (size_t)(last - first) >= MAX_IDS - *count) {
+            free(*ids);
+            *ids = NULL;
+            return -1;
+        }
+
+        while (*count + (size_t)(last - first) + 1 > capacity) {
+            capacity *= 2;
+            *ids = realloc(*ids, capacity * sizeof(int));
+            if (!*ids) {
+                fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+                exit(EXIT_FAILURE);
+            }
+        }
+        for (long id = first; id <= last; id++) {
+            (*ids)[(*count)++] = (int)id;
+        }
+
+        p = end;
+    }
+
+    if (*count == 0) {
+        free(*ids);
+        *ids = NULL;
+        return -1;
+    }
+
+    return 0;
+}
+
+static int listed_ids(char *token, const bulk_sender *sender, int **ids, size_t *count)
+{
+    // Ask for the current listing, whatever is stored may be out of date
+    char *message = build_get_books_request(token, NULL);
+    char *response = pool_request(sender->pool, message);
+    free(message);
+
+    http_response parsed;
+    if (!response || http_parse_response(response, &parsed) < 0 || parsed.status != 200) {
+        out_printf("Cannot get the list of books: %.*s\n",
+               response ? (int)strcspn(response, "\r\n") : 11, response ? response : "no response");
+        free(response);
+        return -1;
+    }
+
+    // Only the ids are needed, the tape reads them without building a tree
+    JSON_Tape *tape = json_tape_parse_string(parsed.body);
+    const JSON_Tape_Value *books = json_tape_get_root(tape);
+    size_t listed = json_tape_array_get_count(books);
+
+    *ids = allocate(listed, sizeof(int));
+    *count = 0;
+    for (size_t i = 0; i < listed; i++) {
+        double id = json_tape_object_get_number(json_tape_array_get_object(books, i), "id");
+        if (id > 0 && id <= INT_MAX) {
+            (*ids)[(*count)++] = (int)id;
+        }
+    }
+
+    json_tape_free(tape);
+    free(response);
+    return 0;
+}
+
+static int is_retryable(int status)
+{
+    // No answer, an overloaded server or a server error may go away on the next try
+    return status < 0 || status == 429 || status / 100 == 5;
+}
+
+static void sleep_ms(long ms)
+{
+    struct timespec delay = { ms / 1000, (ms % 1000) * 1000000L };
+    nanosleep(&delay, NULL);
+}
+
+static void delete_batch(const int *ids, size_t count, int last_attempt, char *token,
+                         book_cache *cache, book_catalog *catalog, const bulk_sender *sender,
+                         delete_summary *summary, int *retry, size_t *retry_count)
+{
+    char **messages = allocate(count, sizeof(char *));
+    char **responses = allocate(count, sizeof(char *));
+
+    for (size_t i = 0; i < count; i++) {
+        char id_str[16];
+        snprintf(id_str, sizeof(id_str), "%d", ids[i]);
+        char *url = build_delete_book_url(id_str);
+        messages[i] = build_delete_book_request(url, token);
+        free(url);
+    }
+
+    bulk_send(sender, messages, responses, count);
+
+    for (size_t i = 0; i < count; i++) {
+        int status = responses[i] ? http_status(responses[i]) : -1;
+
+        if (is_retryable(status) && !last_attempt) {
+            retry[(*retry_count)++] = ids[i];
+        } else if (status / 100 == 2) {
+            summary->deleted++;
+        } else if (status == 404) {
+            summary->missing++;
+        } else {
+            // Only the failures are listed, the rest goes in the summary
+            out_printf("id %d: %.*s\n", ids[i], responses[i] ? (int)strcspn(responses[i], "\r\n") : 11,
+                   responses[i] ? responses[i] : "no response");
+            summary->failed++;
+        }
+
+        // A deleted or missing book is dropped from the caches
+        if (responses[i]) {
+            cache_deleted_book(responses[i], ids[i], cache, catalog);
+        }
+
+        free(messages[i]);
+        free(responses[i]);
+    }
+
+    free(messages);
+    free(responses);
+}
+
+void delete_books(char *spec, char *token, book_cache *cache, book_catalog *catalog,
+                  const bulk_sender *sender)
+{
+    if (!token) {
+        out_printf("Cannot delete books - invalid or missing token\n");
+        return;
+    }
+
+    int *ids;
+    size_t count;
+    double start = now_seconds();
+
+    if (!strcasecmp(spec, "all")) {
+        if (listed_ids(token, sender, &ids, &count) < 0) {
+            return;
+        }
+    } else if (parse_id_list(spec, &ids, &count) < 0) {
+        out_printf("Invalid ids, expected e.g. 3,7,10-20 or all\n");
+        return;
+    }
+
+    // Ids to retry go to a second array, which becomes the next round
+    int *retry = allocate(count, sizeof(int));
+    size_t batch_size = batch_capacity(sender);
+    size_t pending = count, retried = 0;
+    delete_summary summary = { 0, 0, 0 };
+
+    for (int attempt = 1; attempt <= DELETE_ATTEMPTS && pending > 0; attempt++) {
+        size_t retry_count = 0;
+
+        if (attempt > 1) {
+            sleep_ms(RETRY_DELAY_MS << (attempt - 2));
+            retried += pending;
+        }
+
+        for (size_t first = 0; first < pending; first += batch_size) {
+            size_t batch = pending - first < batch_size ? pending - first : batch_size;
+            delete_batch(ids + first, batch, attempt == DELETE_ATTEMPTS, token, cache, catalog,
+                         sender, &summary, retry, &retry_count);
+        }
+
+        int *swap = ids;
+        ids = retry;
+        retry = swap;
+        pending = retry_count;
+    }
+
+    double elapsed = now_seconds() - start;
+    out_printf("Deleted %zu of %zu books in %.2f s (%.1f books/s), %zu not found, %zu failed, %zu retried\n",
+           summary.deleted, count, elapsed, elapsed > 0 ? summary.deleted / elapsed : 0.0,
+           summary.missing, summary.failed, retried);
+
+    free(ids);
+    free(retry);
+}
+
+static void lookup_task(void *arg)
+{
+    lookup_task_arg *task = arg;
+    lookup_batch *batch = task->batch;
+
+    // Repeated ids in the list share one request
+    book_lookup *lookup = &batch->lookups[task->index];
+    lookup->result = pool_request_shared(batch->pool, lookup->message);
+
+    pthread_mutex_lock(&batch->lock);
+    batch->finished[batch->finished_count++] = task->index;
+    pthread_cond_signal(&batch->finished_one);
+    pthread_mutex_unlock(&batch->lock);
+}
+
+static char *copy_text(const char *text, size_t len)
+{
+    char *copy = allocate(len + 1, 1);
+    memcpy(copy, text, len);
+    copy[len] = '\0';
+    return copy;
+}
+
+static char *lookup_output(book_lookup *lookup, book_cache *cache, book_catalog *catalog)
+{
+    const flight_result *result = lookup->result;
+    if (!result || !result->valid) {
+        return copy_text("no response", 11);
+    }
+
+    // 304: the cached copy is still current, it may have been evicted meanwhile
+    if (result->parsed.status == 304 && lookup->stale_body) {
+        cache_entry *entry = cache_lookup(cache, lookup->id);
+        if (entry) {
+            cache_touch(entry);
+        }
+        catalog_touch_book(catalog, lookup->id);
+        char *output = lookup->stale_body;
+        lookup->stale_body = NULL;
+        return output;
+    }
+
+    // Books and 404s are cached like a single get_book does
+    if (result->parsed.status != 304) {
+        store_fetched_book(result, cache, catalog, lookup->id);
+    }
+
+    return copy_text(result->parsed.body, result->parsed.body_len);
+}
+
+void get_many_books(char *spec, char *token, book_cache *cache, book_catalog *catalog,
+                    const bulk_sender *sender)
+{
+    int *ids;
+    size_t count;
+
+    if (parse_id_list(spec, &ids, &count) < 0) {
+        out_printf("Invalid ids, expected e.g. 3,7,10-20\n");
+        return;
+    }
+
+    lookup_batch batch;
+    batch.pool = sender->pool;
+    batch.lookups = allocate(count, sizeof(book_lookup));
+    batch.finished = allocate(count, sizeof(size_t));
+    batch.finished_count = 0;
+    pthread_mutex_init(&batch.lock, NULL);
+    pthread_cond_init(&batch.finished_one, NULL);
+    lookup_task_arg *tasks = allocate(count, sizeof(lookup_task_arg));
+    size_t remote = 0, printed = 0;
+
+    // Answer what the caches can, and queue a request for the rest
+    for (size_t i = 0; i < count; i++) {
+        book_lookup *lookup = &batch.lookups[i];
+        cache_entry *entry;
+        lookup->id = ids[i];
+
+        const char *local = find_local_answer(cache, catalog, ids[i], &entry);
+        if (local) {
+            lookup->output = copy_text(local, strlen(local));
+            continue;
+        }
+
+        char id_str[16];
+        snprintf(id_str, sizeof(id_str), "%d", ids[i]);
+        char *url = build_url(GET_PATH, id_str);
+        lookup->message = create_get_message(url, token, entry);
+        lookup->stale_body = entry ? copy_text(entry->body, strlen(entry->body)) : NULL;
+        free(url);
+
+        tasks[i].batch = &batch;
+        tasks[i].index = i;
+        remote++;
+    }
+
+    // Cached answers come first when streaming
+    for (size_t i = 0; sender->stream && i < count; i++) {
+        if (batch.lookups[i].output) {
+            out_printf("id=%d ", ids[i]);
+            out_line(batch.lookups[i].output);
+        }
+    }
+
+    // Submitted only now, so the workers never see the caches being read
+    engine_group group;
+    engine_group_init(&group);
+    for (size_t i = 0; i < count; i++) {
+        if (batch.lookups[i].message) {
+            engine_submit(sender->engine, &group, lookup_task, &tasks[i]);
+        }
+    }
+
+    // The main thread stores and prints each response as it finishes
+    for (size_t handled = 0; handled < remote; handled++) {
+        pthread_mutex_lock(&batch.lock);
+        while (batch.finished_count == handled) {
+            pthread_cond_wait(&batch.finished_one, &batch.lock);
+        }
+        size_t index = batch.finished[handled];
+        pthread_mutex_unlock(&batch.lock);
+
+        book_lookup *lookup = &batch.lookups[index];
+        lookup->output = lookup_output(lookup, cache, catalog);
+        if (sender->stream) {
+            out_printf("id=%d ", lookup->id);
+            out_line(lookup->output);
+            // shown right away, not when the whole command is done
+            out_flush();
+        }
+
+        // In input order, print everything up to the first id still waiting
+        while (!sender->stream && printed < count && batch.lookups[printed].output) {
+            out_printf("id=%d ", batch.lookups[printed].id);
+            out_line(batch.lookups[printed].output);
+            printed++;
+        }
+    }
+    while (!sender->stream && printed < count) {
+        out_printf("id=%d ", batch.lookups[printed].id);
+        out_line(batch.lookups[printed].output);
+        printed++;
+    }
+
+    engine_group_wait(&group);
+    engine_group_destroy(&group);
+
+    for (size_t i = 0; i < count; i++) {
+        free(batch.lookups[i].message);
+        free(batch.lookups[i].stale_body);
+        free(batch.lookups[i].output);
+        pool_release_result(sender->pool, batch.lookups[i].result);
+    }
+    pthread_cond_destroy(&batch.finished_one);
+    pthread_mutex_destroy(&batch.lock);
+    free(batch.lookups);
+    free(batch.finished);
+    free(tasks);
+    free(ids);
+}
@@ -0,0 +1,70 @@
+#ifndef BULK_H_
+#define BULK_H_
+
+#include <stddef.h>
+
+#include "cache.h"
+#include "catalog.h"
+#include "pool.h"
+#include "engine.h"
+#include "parson.h"
+
+#define BOOK_FIELDS 5
+#define MAX_IDS (1 << 20)
+
+// What is needed to send many requests at once
+typedef struct {
+    connection_pool *pool; // connections the requests are pipelined on
+    task_engine *engine;   // threads sending one pipeline each
+    size_t depth;          // requests written on a connection before reading the responses
+    int stream;            // print multi-id get_book results as they arrive, not in input order
+} bulk_sender;
+
+// A run of requests pipelined on one connection by an engine thread
+typedef struct {
+    connection_pool *pool;
+    char **messages;
+    char **responses;      // NULL where no response arrived
+    size_t count;
+} bulk_pipeline;
+
+// Outcome of delete_books
+typedef struct {
+    size_t deleted;        // books the server deleted
+    size_t missing;        // ids the server had no book for
+    size_t failed;         // ids still failing after the retries
+} delete_summary;
+
+// sends count requests over the engine threads, depth at a time per connection, and waits
+// for them; responses (count pointers, freed by the caller) are NULL where none arrived
+void bulk_send(const bulk_sender *sender, char **messages, char **responses, size_t count);
+
+// splits a CSV line in place into at most max fields, handling quoted fields;
+// returns the number of fields, or -1 if a quote isn't closed
+int split_csv_line(char *line, char **fields, int max);
+
+// builds a book from a JSON object line, or returns NULL and sets reason
+JSON_Value *book_from_json(const char *line, const char **reason);
+
+// builds a book from CSV fields, columns[i] being the field of the i-th book field
+JSON_Value *book_from_csv(char **fields, int count, const int *columns, const char **reason);
+
+// uploads every book of a JSONL or CSV file, printing the status of each and the throughput
+void add_books(char *path, char *token, book_cache *cache, book_catalog *catalog,
+               const bulk_sender *sender);
+
+// parses ids and ranges such as "3,7 10-20" into a malloc'd array; returns 0 on success,
+// -1 if the list is empty, malformed or longer than MAX_IDS
+int parse_id_list(const char *spec, int **ids, size_t *count);
+
+// deletes the books of an id list (see parse_id_list), or every listed book for "all",
+// retrying requests that got no answer or a server error, and prints a summary
+void delete_books(char *spec, char *token, book_cache *cache, book_catalog *catalog,
+                  const bulk_sender *sender);
+
+// prints the books of an id list (see parse_id_list), answering from the caches what they
+// can and fetching the rest in parallel; in input order, or as they arrive with sender->stream
+void get_many_books(char *spec, char *token, book_cache *cache, book_catalog *catalog,
+                    const bulk_sender *sender);
+
+#endif
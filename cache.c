@@ -0,0 +1,399 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+#include "parson.h"
+
+static size_t bucket_of(const book_cache *cache, int id)
+{
+    // Ids are mostly sequential, spread them with a multiplicative hash
+    return ((unsigned int)id * 2654435761u) & (cache->bucket_count - 1);
+}
+
+static void copy_validator(char *dst, const char *src, size_t size)
+{
+    // Keep an empty string when the server sent no validator
+    snprintf(dst, size, "%s", src ? src : "");
+}
+
+static void lru_unlink(book_cache *cache, cache_entry *entry)
+{
+    // Detach the entry from its neighbours in the LRU list
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        cache->head = entry->next;
+    }
+
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        cache->tail = entry->prev;
+    }
+
+    entry->prev = entry->next = NULL;
+}
+
+static void lru_push_front(book_cache *cache, cache_entry *entry)
+{
+    // The most recently used entry goes first
+    entry->prev = NULL;
+    entry->next = cache->head;
+
+    if (cache->head) {
+        cache->head->prev = entry;
+    } else {
+        cache->tail = entry;
+    }
+
+    cache->head = entry;
+}
+
+static cache_entry *bucket_find(const book_cache *cache, int id, cache_entry ***link)
+{
+    // Walk the chain, remembering the pointer that leads to each entry so it can be unlinked
+    cache_entry **it = &cache->buckets[bucket_of(cache, id)];
+
+    while (*it && (*it)->id != id) {
+        it = &(*it)->bucket_next;
+    }
+
+    if (link) {
+        *link = it;
+    }
+
+    return *it;
+}
+
+static void entry_free(book_cache *cache, cache_entry *entry, cache_entry **link)
+{
+    // Unlink the entry from both structures and release it
+    *link = entry->bucket_next;
+    lru_unlink(cache, entry);
+    cache->count--;
+
+    free(entry->body);
+    free(entry);
+}
+
+static missing_entry *missing_slot(const book_cache *cache, int id)
+{
+    // Direct mapped, a newer 404 simply takes the slot of an older one
+    return (missing_entry *)&cache->missing[((unsigned int)id * 2654435761u) % MISSING_SLOTS];
+}
+
+static int is_listed(const book_cache *cache, int id)
+{
+    return id >= 0 && (size_t)id < cache->listed_bits &&
+           (cache->listed[id / 8] & (1u << (id % 8)));
+}
+
+static void grow_listing(book_cache *cache, int id)
+{
+    // Room for at least id, doubling to keep appends cheap
+    size_t bits = cache->listed_bits ? cache->listed_bits : 64;
+    while (bits <= (size_t)id) {
+        bits *= 2;
+    }
+
+    unsigned char *listed = realloc(cache->listed, bits / 8);
+    if (!listed) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    // New ids start out as not listed
+    memset(listed + cache->listed_bits / 8, 0, (bits - cache->listed_bits) / 8);
+    cache->listed = listed;
+    cache->listed_bits = bits;
+}
+
+static void mark_listed(book_cache *cache, int id)
+{
+    if ((size_t)id >= cache->listed_bits) {
+        grow_listing(cache, id);
+    }
+    cache->listed[id / 8] |= (unsigned char)(1u << (id % 8));
+}
+
+void cache_init(book_cache *cache, size_t capacity, int ttl, int missing_ttl)
+{
+    cache->capacity = capacity;
+    cache->ttl = ttl;
+    cache->count = 0;
+    cache->head = cache->tail = NULL;
+
+    // Nothing is known to be missing yet
+    memset(cache->missing, 0, sizeof(cache->missing));
+    cache->missing_ttl = missing_ttl;
+    cache->missing_body = NULL;
+    cache->listed = NULL;
+    cache->listed_bits = 0;
+    cache->listed_limit = 0;
+    cache->listed_at = 0;
+
+    // Size the table for a load factor of at most one
+    cache->bucket_count = 16;
+    while (cache->bucket_count < capacity) {
+        cache->bucket_count *= 2;
+    }
+
+    cache->buckets = calloc(cache->bucket_count, sizeof(cache_entry *));
+    if (!cache->buckets) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void cache_clear(book_cache *cache)
+{
+    // Free the entries in LRU order, then forget the buckets
+    cache_entry *entry = cache->head;
+    while (entry) {
+        cache_entry *next = entry->next;
+        free(entry->body);
+        free(entry);
+        entry = next;
+    }
+
+    memset(cache->buckets, 0, cache->bucket_count * sizeof(cache_entry *));
+    cache->head = cache->tail = NULL;
+    cache->count = 0;
+
+    // What was missing for one user says nothing about the next one
+    memset(cache->missing, 0, sizeof(cache->missing));
+    cache_forget_listing(cache);
+}
+
+void cache_destroy(book_cache *cache)
+{
+    cache_clear(cache);
+    free(cache->buckets);
+    free(cache->missing_body);
+    free(cache->listed);
+    cache->buckets = NULL;
+    cache->missing_body = NULL;
+    cache->listed = NULL;
+    cache->listed_bits = 0;
+}
+
+cache_entry *cache_lookup(book_cache *cache, int id)
+{
+    cache_entry *entry = bucket_find(cache, id, NULL);
+
+    // A hit makes the entry the last one to be evicted
+    if (entry) {
+        lru_unlink(cache, entry);
+        lru_push_front(cache, entry);
+    }
+
+    return entry;
+}
+
+int cache_is_fresh(const book_cache *cache, const cache_entry *entry)
+{
+    return time(NULL) - entry->validated < cache->ttl;
+}
+
+int cache_has_validators(const cache_entry *entry)
+{
+    return entry->etag[0] != '\0' || entry->last_modified[0] != '\0';
+}
+
+void cache_touch(cache_entry *entry)
+{
+    entry->validated = time(NULL);
+}
+
+void cache_store(book_cache *cache, int id, const char *body, size_t body_len,
+                 const char *etag, const char *last_modified)
+{
+    // The book exists after all
+    missing_entry *slot = missing_slot(cache, id);
+    if (slot->id == id) {
+        slot->id = 0;
+    }
+    if (cache->listed_at) {
+        cache_listing_add(cache, id);
+    }
+
+    // A disabled cache stores nothing
+    if (cache->capacity == 0) {
+        return;
+    }
+
+    // Copy the body first, so a failed allocation leaves the cache untouched
+    char *copy = malloc(body_len + 1);
+    if (!copy) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, body, body_len);
+    copy[body_len] = '\0';
+
+    cache_entry **link;
+    cache_entry *entry = bucket_find(cache, id, &link);
+
+    if (entry) {
+        // Replace the body of a book that is already cached
+        free(entry->body);
+        lru_unlink(cache, entry);
+    } else {
+        // Make room by evicting the least recently used book
+        if (cache->count >= cache->capacity) {
+            cache_entry **tail_link;
+            bucket_find(cache, cache->tail->id, &tail_link);
+            entry_free(cache, cache->tail, tail_link);
+            // The eviction may have changed the chain id belongs to
+            bucket_find(cache, id, &link);
+        }
+
+        entry = calloc(1, sizeof(cache_entry));
+        if (!entry) {
+            fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+            exit(EXIT_FAILURE);
+        }
+
+        // New entries go at the end of their bucket chain
+        entry->id = id;
+        *link = entry;
+        cache->count++;
+    }
+
+    entry->body = copy;
+    copy_validator(entry->etag, etag, sizeof(entry->etag));
+    copy_validator(entry->last_modified, last_modified, sizeof(entry->last_modified));
+    entry->validated = time(NULL);
+    lru_push_front(cache, entry);
+}
+
+void cache_remove(book_cache *cache, int id)
+{
+    cache_entry **link;
+    cache_entry *entry = bucket_find(cache, id, &link);
+
+    if (entry) {
+        entry_free(cache, entry, link);
+    }
+}
+
+void cache_store_missing(book_cache *cache, int id, const char *body, size_t body_len)
+{
+    // Remember the id for a short while
+    missing_entry *slot = missing_slot(cache, id);
+    slot->id = id;
+    slot->expires = time(NULL) + cache->missing_ttl;
+
+    // Keep the latest 404 body to replay it for other missing ids
+    char *copy = malloc(body_len + 1);
+    if (!copy) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, body, body_len);
+    copy[body_len] = '\0';
+    free(cache->missing_body);
+    cache->missing_body = copy;
+
+    // It is not part of the library anymore
+    cache_listing_remove(cache, id);
+}
+
+int cache_is_missing(const book_cache *cache, int id)
+{
+    // A recent 404 for this very id
+    const missing_entry *slot = missing_slot(cache, id);
+    if (slot->id == id && time(NULL) < slot->expires) {
+        return 1;
+    }
+
+    // Or an id absent from a listing that is still fresh
+    return cache->listed_at && time(NULL) - cache->listed_at < cache->ttl && !is_listed(cache, id);
+}
+
+void cache_set_listing(book_cache *cache, const char *json, time_t received)
+{
+    // Only the ids are needed, the tape reads them without building a tree
+    JSON_Tape *tape = json_tape_parse_string(json);
+    const JSON_Tape_Value *books = json_tape_get_root(tape);
+
+    cache_forget_listing(cache);
+    if (json_tape_value_get_type(books) != JSONArray) {
+        json_tape_free(tape);
+        return;
+    }
+
+    // Start from an empty set and mark every listed id
+    if (cache->listed) {
+        memset(cache->listed, 0, cache->listed_bits / 8);
+    }
+    size_t count = json_tape_array_get_count(books);
+
+    // The bitset is sized by the largest id, so one huge id would take a huge allocation;
+    // past a small multiple of the listing, which ids are listed is simply not kept
+    cache->listed_limit = count < LISTED_MIN_IDS / LISTED_IDS_PER_BOOK ? LISTED_MIN_IDS
+                                                                       : count * LISTED_IDS_PER_BOOK;
+    int usable = 1;
+    for (size_t i = 0; usable && i < count; i++) {
+        double id = json_tape_object_get_number(json_tape_array_get_object(books, i), "id");
+        if (id >= (double)cache->listed_limit) {
+            usable = 0;
+        } else if (id > 0) {
+            mark_listed(cache, (int)id);
+        }
+    }
+
+    json_tape_free(tape);
+    cache->listed_at = usable ? received : 0;
+}
+
+void cache_listing_add(book_cache *cache, int id)
+{
+    if (id < 0) {
+        return;
+    }
+
+    // Each book added may take the bitset a little further, like a longer listing
+    cache->listed_limit += LISTED_IDS_PER_BOOK;
+    if ((size_t)id >= cache->listed_limit) {
+        cache_forget_listing(cache);
+        return;
+    }
+
+    mark_listed(cache, id);
+}
+
+void cache_listing_remove(book_cache *cache, int id)
+{
+    if (is_listed(cache, id)) {
+        cache->listed[id / 8] &= (unsigned char)~(1u << (id % 8));
+    }
+}
+
+void cache_forget_listing(book_cache *cache)
+{
+    cache->listed_at = 0;
+}
+
+size_t cache_prune_unlisted(book_cache *cache)
+{
+    size_t removed = 0;
+
+    // Without a usable listing nothing is known to be gone
+    if (!cache->listed_at) {
+        return 0;
+    }
+
+    cache_entry *entry = cache->head;
+    while (entry) {
+        cache_entry *next = entry->next;
+        if (!is_listed(cache, entry->id)) {
+            cache_remove(cache, entry->id);
+            removed++;
+        }
+        entry = next;
+    }
+
+    return removed;
+}
@@ -0,0 +1,100 @@
+#ifndef CACHE_H_
+#define CACHE_H_
+
+#include <stddef.h>
+#include <time.h>
+
+#define ETAG_LEN 128
+#define DATE_LEN 64
+#define MISSING_SLOTS 256
+#define LISTED_MIN_IDS 65536    // ids the listing bitset may always cover
+#define LISTED_IDS_PER_BOOK 64  // and how far it may reach for each listed book
+
+// One cached book, linked both in its hash bucket and in the LRU list
+typedef struct cache_entry {
+    int id;                          // book id
+    char *body;                      // JSON body returned by the server for the book
+    char etag[ETAG_LEN];             // ETag validator, empty if the server sent none
+    char last_modified[DATE_LEN];    // Last-Modified validator, empty if the server sent none
+    time_t validated;                // when the body was last received or revalidated
+    struct cache_entry *prev, *next; // LRU list, most recently used first
+    struct cache_entry *bucket_next; // next entry in the same hash bucket
+} cache_entry;
+
+// An id the server recently answered 404 for
+typedef struct {
+    int id;                          // book id, 0 for a free slot
+    time_t expires;                  // until when the id is known to be missing
+} missing_entry;
+
+// Bounded LRU cache of book bodies keyed by id, plus what is known about missing ids
+typedef struct {
+    cache_entry **buckets; // hash table of entries by id
+    size_t bucket_count;   // always a power of two
+    cache_entry *head;     // most recently used entry
+    cache_entry *tail;     // least recently used entry, evicted first
+    size_t count;          // number of cached books
+    size_t capacity;       // maximum number of cached books, 0 disables the cache
+    int ttl;               // seconds an entry is served without asking the server
+
+    missing_entry missing[MISSING_SLOTS]; // recent 404s, one slot per id hash
+    int missing_ttl;       // seconds a 404 is remembered
+    char *missing_body;    // body of the last 404, replayed for ids known to be missing
+    unsigned char *listed; // bitset of the ids in the last get_books listing
+    size_t listed_bits;    // ids covered by the bitset
+    size_t listed_limit;   // ids the bitset may cover for the current listing
+    time_t listed_at;      // when the listing was received, 0 if the bitset is unusable
+} book_cache;
+
+// initializes an empty cache holding at most capacity books, remembering 404s for missing_ttl seconds
+void cache_init(book_cache *cache, size_t capacity, int ttl, int missing_ttl);
+
+// drops every entry (e.g. when the user changes)
+void cache_clear(book_cache *cache);
+
+// drops every entry and frees the hash table
+void cache_destroy(book_cache *cache);
+
+// returns the entry for id and marks it as recently used, or NULL on a miss
+cache_entry *cache_lookup(book_cache *cache, int id);
+
+// checks if an entry is young enough to be served without contacting the server
+int cache_is_fresh(const book_cache *cache, const cache_entry *entry);
+
+// checks if an entry can be revalidated with a conditional request
+int cache_has_validators(const cache_entry *entry);
+
+// marks an entry as just confirmed by the server (after a 304)
+void cache_touch(cache_entry *entry);
+
+// stores or replaces the body of a book, evicting the least recently used entry if full;
+// etag and last_modified can be NULL
+void cache_store(book_cache *cache, int id, const char *body, size_t body_len,
+                 const char *etag, const char *last_modified);
+
+// removes the entry for id, if any
+void cache_remove(book_cache *cache, int id);
+
+// remembers that the server answered 404 for id, with the given body
+void cache_store_missing(book_cache *cache, int id, const char *body, size_t body_len);
+
+// checks if id is known not to exist: a recent 404, or absent from a fresh listing
+int cache_is_missing(const book_cache *cache, int id);
+
+// replaces the known ids with the ones in a get_books listing (a JSON array)
+// received from the server at the given time
+void cache_set_listing(book_cache *cache, const char *json, time_t received);
+
+// adds an id created since the listing was received
+void cache_listing_add(book_cache *cache, int id);
+
+// removes an id deleted since the listing was received
+void cache_listing_remove(book_cache *cache, int id);
+
+// stops trusting the known ids until the next listing
+void cache_forget_listing(book_cache *cache);
+
+// drops the cached books missing from the current listing; returns how many were dropped
+size_t cache_prune_unlisted(book_cache *cache);
+
+#endif
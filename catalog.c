@@ -0,0 +1,746 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "catalog.h"
+#include "parson.h"
+
+#define CATALOG_STARTING_CAPACITY 64
+
+static catalog_header *header_of(const book_catalog *catalog)
+{
+    return (catalog_header *)catalog->map;
+}
+
+static catalog_record *record_at(const book_catalog *catalog, uint32_t slot)
+{
+    // Slot 0 of the file holds the header
+    return (catalog_record *)(catalog->map + (size_t)(slot + 1) * CATALOG_RECORD_SIZE);
+}
+
+static size_t index_position(const book_catalog *catalog, int32_t id)
+{
+    // Same multiplicative hash as the in-memory cache, sequential ids spread well
+    size_t mask = catalog->index_capacity - 1;
+    size_t pos = ((uint32_t)id * 2654435761u) & mask;
+
+    // Linear probing up to the id or a free position
+    while (catalog->index_ids[pos] != 0 && catalog->index_ids[pos] != id) {
+        pos = (pos + 1) & mask;
+    }
+
+    return pos;
+}
+
+static void index_put(book_catalog *catalog, int32_t id, uint32_t slot)
+{
+    size_t pos = index_position(catalog, id);
+    catalog->index_ids[pos] = id;
+    catalog->index_slots[pos] = slot;
+}
+
+static void index_delete(book_catalog *catalog, int32_t id)
+{
+    size_t mask = catalog->index_capacity - 1;
+    size_t pos = index_position(catalog, id);
+    if (catalog->index_ids[pos] == 0) {
+        return;
+    }
+
+    // Shift the following entries back so no probe chain gets broken
+    size_t next = (pos + 1) & mask;
+    while (catalog->index_ids[next] != 0) {
+        size_t home = ((uint32_t)catalog->index_ids[next] * 2654435761u) & mask;
+        // Move the entry if pos lies between its home position and where it sits now
+        if (((next - home) & mask) >= ((next - pos) & mask)) {
+            catalog->index_ids[pos] = catalog->index_ids[next];
+            catalog->index_slots[pos] = catalog->index_slots[next];
+            pos = next;
+        }
+        next = (next + 1) & mask;
+    }
+
+    catalog->index_ids[pos] = 0;
+}
+
+static int index_rebuild(book_catalog *catalog)
+{
+    catalog_header *header = header_of(catalog);
+
+    // Keep the index at most half full
+    size_t capacity = 16;
+    while (capacity < (size_t)header->capacity * 2) {
+        capacity *= 2;
+    }
+
+    int32_t *ids = calloc(capacity, sizeof(int32_t));
+    uint32_t *slots = calloc(capacity, sizeof(uint32_t));
+    if (!ids || !slots) {
+        free(ids);
+        free(slots);
+        return -1;
+    }
+
+    free(catalog->index_ids);
+    free(catalog->index_slots);
+    catalog->index_ids = ids;
+    catalog->index_slots = slots;
+    catalog->index_capacity = capacity;
+
+    // Index every record in use
+    for (uint32_t slot = 0; slot < header->count; slot++) {
+        index_put(catalog, record_at(catalog, slot)->id, slot);
+    }
+    catalog->generation = header->generation;
+
+    return 0;
+}
+
+// maps the first size bytes of the file in place of the current mapping
+static int map_bytes(book_catalog *catalog, size_t size)
+{
+    char *map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, catalog->fd, 0);
+    if (map == MAP_FAILED) {
+        return -1;
+    }
+
+    if (catalog->map) {
+        munmap(catalog->map, catalog->map_size);
+    }
+
+    catalog->map = map;
+    catalog->map_size = size;
+    return 0;
+}
+
+static int map_file(book_catalog *catalog, uint32_t capacity)
+{
+    size_t size = (size_t)(capacity + 1) * CATALOG_RECORD_SIZE;
+    struct stat st;
+
+    // Grow the file first, the new records read as zeros; it never shrinks, since
+    // another client may have it mapped
+    if (fstat(catalog->fd, &st) < 0 || (st.st_size < (off_t)size && ftruncate(catalog->fd, (off_t)size) < 0)) {
+        return -1;
+    }
+
+    if (map_bytes(catalog, size) < 0) {
+        return -1;
+    }
+
+    header_of(catalog)->capacity = capacity;
+    return 0;
+}
+
+static int lock_file(int fd, short type)
+{
+    struct flock lock;
+    memset(&lock, 0, sizeof(lock));
+    lock.l_type = type;
+    lock.l_whence = SEEK_SET;
+
+    // The whole file, waiting for the client holding it
+    while (fcntl(fd, F_SETLKW, &lock) < 0) {
+        if (errno != EINTR) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+// checks that a record only points inside itself and at the stored listing
+static int record_is_valid(const catalog_header *header, const catalog_record *record)
+{
+    return record->id > 0 &&
+           record->body_len < sizeof(record->body) &&
+           memchr(record->etag, '\0', sizeof(record->etag)) != NULL &&
+           memchr(record->last_modified, '\0', sizeof(record->last_modified)) != NULL &&
+           memchr(record->title, '\0', sizeof(record->title)) != NULL &&
+           (!(record->flags & CATALOG_LISTED) || record->listing_pos < header->listing_count);
+}
+
+// checks every record in use, once the header was found valid
+static int records_are_valid(const book_catalog *catalog)
+{
+    catalog_header *header = header_of(catalog);
+
+    if (memchr(header->listing_etag, '\0', sizeof(header->listing_etag)) == NULL) {
+        return 0;
+    }
+
+    for (uint32_t slot = 0; slot < header->count; slot++) {
+        if (!record_is_valid(header, record_at(catalog, slot))) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int is_valid(const book_catalog *catalog, off_t file_size)
+{
+    catalog_header *header = header_of(catalog);
+
+    // The layout must match and every slot in use must be inside the file
+    return memcmp(header->magic, CATALOG_MAGIC, sizeof(header->magic)) == 0 &&
+           header->record_size == CATALOG_RECORD_SIZE &&
+           header->count <= header->capacity &&
+           (off_t)(header->capacity + 1) * CATALOG_RECORD_SIZE <= file_size;
+}
+
+// tells the other clients of the user to rebuild their index
+static void changed(book_catalog *catalog)
+{
+    header_of(catalog)->generation++;
+    catalog->generation = header_of(catalog)->generation;
+}
+
+static void reset(book_catalog *catalog)
+{
+    uint32_t generation = header_of(catalog)->generation;
+
+    // Start over with an empty catalog
+    memset(catalog->map, 0, CATALOG_RECORD_SIZE);
+    header_of(catalog)->generation = generation;
+    memcpy(header_of(catalog)->magic, CATALOG_MAGIC, sizeof(header_of(catalog)->magic));
+    header_of(catalog)->record_size = CATALOG_RECORD_SIZE;
+    header_of(catalog)->capacity = (uint32_t)(catalog->map_size / CATALOG_RECORD_SIZE) - 1;
+    changed(catalog);
+}
+
+// maps what other clients added to the file and rebuilds the index if they moved records;
+// the file must be locked
+static int catch_up(book_catalog *catalog)
+{
+    struct stat st;
+    if (fstat(catalog->fd, &st) < 0 || st.st_size < 2 * CATALOG_RECORD_SIZE) {
+        return -1;
+    }
+
+    // The header can only be trusted once all of the file it describes is mapped
+    size_t size = (size_t)st.st_size - (size_t)st.st_size % CATALOG_RECORD_SIZE;
+    if (size != catalog->map_size && map_bytes(catalog, size) < 0) {
+        return -1;
+    }
+
+    // Records moved by another client are checked again, like when the file is opened
+    int moved = header_of(catalog)->generation != catalog->generation;
+    if (!is_valid(catalog, (off_t)size) || (moved && !records_are_valid(catalog))) {
+        reset(catalog);
+        moved = 1;
+    }
+
+    return moved ? index_rebuild(catalog) : 0;
+}
+
+// locks the file against the other clients of the user and catches up with their
+// changes; returns -1 (holding no lock) if the catalog can't be used
+static int catalog_lock(book_catalog *catalog)
+{
+    if (catalog->fd < 0 || lock_file(catalog->fd, F_WRLCK) < 0) {
+        return -1;
+    }
+
+    if (catch_up(catalog) < 0) {
+        lock_file(catalog->fd, F_UNLCK);
+        return -1;
+    }
+
+    return 0;
+}
+
+static void catalog_unlock(book_catalog *catalog)
+{
+    lock_file(catalog->fd, F_UNLCK);
+}
+
+static void invalidate_listing(book_catalog *catalog)
+{
+    // The listing no longer matches the server, it has to be fetched in full again
+    header_of(catalog)->listing_validated = 0;
+    header_of(catalog)->listing_etag[0] = '\0';
+}
+
+static catalog_record *find_record(const book_catalog *catalog, int id)
+{
+    if (catalog->fd < 0 || id <= 0) {
+        return NULL;
+    }
+
+    size_t pos = index_position(catalog, id);
+    if (catalog->index_ids[pos] == 0) {
+        return NULL;
+    }
+
+    return record_at(catalog, catalog->index_slots[pos]);
+}
+
+static catalog_record *add_record(book_catalog *catalog, int id)
+{
+    catalog_header *header = header_of(catalog);
+
+    // Double the file when every slot is used
+    if (header->count == header->capacity) {
+        if (map_file(catalog, header->capacity * 2) < 0 || index_rebuild(catalog) < 0) {
+            return NULL;
+        }
+        header = header_of(catalog);
+        changed(catalog);
+    }
+
+    // New records take the first free slot
+    uint32_t slot = header->count++;
+    catalog_record *record = record_at(catalog, slot);
+    memset(record, 0, sizeof(*record));
+    record->id = id;
+    index_put(catalog, id, slot);
+    changed(catalog);
+    return record;
+}
+
+static void remove_record(book_catalog *catalog, catalog_record *record)
+{
+    catalog_header *header = header_of(catalog);
+    catalog_record *last = record_at(catalog, header->count - 1);
+
+    index_delete(catalog, record->id);
+
+    // Move the last record into the hole, so slots in use stay contiguous
+    if (record != last) {
+        memcpy(record, last, sizeof(*record));
+        index_put(catalog, record->id, (uint32_t)(((char *)record - catalog->map) / CATALOG_RECORD_SIZE) - 1);
+    }
+
+    header->count--;
+    changed(catalog);
+}
+
+void catalog_init(book_catalog *catalog)
+{
+    memset(catalog, 0, sizeof(*catalog));
+    catalog->fd = -1;
+}
+
+int catalog_open(book_catalog *catalog, const char *dir, const char *user, int ttl)
+{
+    char path[4096];
+    struct stat st;
+
+    catalog_close(catalog);
+    catalog->ttl = ttl;
+
+    // One file per user, keep only harmless characters of the name
+    if (mkdir(dir, 0700) < 0 && errno != EEXIST) {
+        return -1;
+    }
+    int len = snprintf(path, sizeof(path), "%s/", dir);
+    for (const char *c = user; *c && len < (int)sizeof(path) - 5; c++) {
+        int safe = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+                   (*c >= '0' && *c <= '9') || *c == '-' || *c == '_';
+        path[len++] = safe ? *c : '_';
+    }
+    snprintf(path + len, sizeof(path) - len, ".cat");
+
+    // Another client of the user may be creating or growing the file
+    catalog->fd = open(path, O_RDWR | O_CREAT, 0600);
+    if (catalog->fd < 0 || lock_file(catalog->fd, F_WRLCK) < 0) {
+        catalog_close(catalog);
+        return -1;
+    }
+    if (fstat(catalog->fd, &st) < 0) {
+        catalog_close(catalog);
+        return -1;
+    }
+
+    // Map what is there, or a fresh file if it is too small to hold a header
+    uint32_t capacity = CATALOG_STARTING_CAPACITY;
+    if (st.st_size >= 2 * CATALOG_RECORD_SIZE) {
+        capacity = (uint32_t)(st.st_size / CATALOG_RECORD_SIZE) - 1;
+    }
+    if (map_file(catalog, capacity) < 0) {
+        catalog_close(catalog);
+        return -1;
+    }
+
+    // A file from another version, or a damaged one, is discarded
+    if (!is_valid(catalog, st.st_size) || !records_are_valid(catalog)) {
+        reset(catalog);
+    }
+
+    if (index_rebuild(catalog) < 0) {
+        catalog_close(catalog);
+        return -1;
+    }
+
+    catalog_unlock(catalog);
+    return 0;
+}
+
+void catalog_close(book_catalog *catalog)
+{
+    // Unmapping writes the pages back to the file
+    if (catalog->map) {
+        munmap(catalog->map, catalog->map_size);
+    }
+    if (catalog->fd >= 0) {
+        close(catalog->fd);
+    }
+
+    free(catalog->index_ids);
+    free(catalog->index_slots);
+
+    int ttl = catalog->ttl;
+    catalog_init(catalog);
+    catalog->ttl = ttl;
+}
+
+int catalog_find(book_catalog *catalog, int id, catalog_record *record)
+{
+    if (catalog_lock(catalog) < 0) {
+        return 0;
+    }
+
+    // A record another client damaged in place is treated as missing
+    catalog_record *found = find_record(catalog, id);
+    if (found && !record_is_valid(header_of(catalog), found)) {
+        found = NULL;
+    }
+    if (found) {
+        memcpy(record, found, sizeof(*record));
+    }
+
+    catalog_unlock(catalog);
+    return found != NULL;
+}
+
+static void store_book(book_catalog *catalog, int id, const char *body, size_t body_len,
+                       const char *etag, const char *last_modified)
+{
+    catalog_record *record = find_record(catalog, id);
+
+    // Bodies that don't fit a record are not stored
+    if (body_len >= sizeof(record->body)) {
+        if (record) {
+            record->flags &= ~CATALOG_DETAILS;
+        }
+        return;
+    }
+
+    if (!record) {
+        record = add_record(catalog, id);
+        if (!record) {
+            return;
+        }
+    }
+
+    memcpy(record->body, body, body_len);
+    record->body[body_len] = '\0';
+    record->body_len = (uint32_t)body_len;
+    snprintf(record->etag, sizeof(record->etag), "%s", etag ? etag : "");
+    snprintf(record->last_modified, sizeof(record->last_modified), "%s", last_modified ? last_modified : "");
+    record->validated = time(NULL);
+    record->flags |= CATALOG_DETAILS;
+}
+
+void catalog_store_book(book_catalog *catalog, int id, const char *body, size_t body_len,
+                        const char *etag, const char *last_modified)
+{
+    if (id <= 0 || catalog_lock(catalog) < 0) {
+        return;
+    }
+
+    store_book(catalog, id, body, body_len, etag, last_modified);
+    catalog_unlock(catalog);
+}
+
+void catalog_touch_book(book_catalog *catalog, int id)
+{
+    if (catalog_lock(catalog) < 0) {
+        return;
+    }
+
+    catalog_record *record = find_record(catalog, id);
+    if (record) {
+        record->validated = time(NULL);
+    }
+
+    catalog_unlock(catalog);
+}
+
+static void remove_book(book_catalog *catalog, int id)
+{
+    catalog_record *record = find_record(catalog, id);
+    if (!record) {
+        return;
+    }
+
+    // Take the book out of the listing, the books after it move up one position
+    if (record->flags & CATALOG_LISTED) {
+        catalog_header *header = header_of(catalog);
+        for (uint32_t slot = 0; slot < header->count; slot++) {
+            catalog_record *other = record_at(catalog, slot);
+            if ((other->flags & CATALOG_LISTED) && other->listing_pos > record->listing_pos) {
+                other->listing_pos--;
+            }
+        }
+        header->listing_count--;
+    }
+
+    remove_record(catalog, record);
+}
+
+void catalog_remove_book(book_catalog *catalog, int id)
+{
+    if (catalog_lock(catalog) < 0) {
+        return;
+    }
+
+    remove_book(catalog, id);
+    catalog_unlock(catalog);
+}
+
+int catalog_listing_is_fresh(book_catalog *catalog)
+{
+    if (catalog_lock(catalog) < 0) {
+        return 0;
+    }
+
+    time_t validated = (time_t)header_of(catalog)->listing_validated;
+    catalog_unlock(catalog);
+    return validated != 0 && time(NULL) - validated < catalog->ttl;
+}
+
+time_t catalog_listing_validated(book_catalog *catalog)
+{
+    if (catalog_lock(catalog) < 0) {
+        return 0;
+    }
+
+    time_t validated = (time_t)header_of(catalog)->listing_validated;
+    catalog_unlock(catalog);
+    return validated;
+}
+
+int catalog_listing_etag(book_catalog *catalog, char *etag, size_t size)
+{
+    etag[0] = '\0';
+    if (catalog_lock(catalog) < 0) {
+        return 0;
+    }
+
+    // Copied while locked, another client may replace it right after; a damaged
+    // header may leave it unterminated
+    const char *stored = header_of(catalog)->listing_etag;
+    snprintf(etag, size, "%.*s", (int)strnlen(stored, ETAG_LEN), stored);
+    catalog_unlock(catalog);
+    return etag[0] != '\0';
+}
+
+// stores the books of a parsed listing; the file must be locked
+static int store_listing(book_catalog *catalog, JSON_Array *books, const char *etag)
+{
+    // Unmark every book, the new listing marks the ones still there
+    for (uint32_t slot = 0; slot < header_of(catalog)->count; slot++) {
+        record_at(catalog, slot)->flags &= ~CATALOG_LISTED;
+    }
+
+    int complete = 1;
+    size_t count = json_array_get_count(books);
+    for (size_t i = 0; i < count; i++) {
+        JSON_Object *book = json_array_get_object(books, i);
+        int id = (int)json_object_get_number(book, "id");
+        const char *title = json_object_get_string(book, "title");
+
+        // Books the listing can't be rebuilt from make it unusable offline
+        if (id <= 0 || !title || strlen(title) >= CATALOG_TITLE_LEN) {
+            complete = 0;
+            continue;
+        }
+
+        catalog_record *record = find_record(catalog, id);
+        if (!record) {
+            record = add_record(catalog, id);
+        }
+        if (!record) {
+            complete = 0;
+            break;
+        }
+
+        snprintf(record->title, sizeof(record->title), "%s", title);
+        record->listing_pos = (uint32_t)i;
+        record->flags |= CATALOG_LISTED;
+    }
+
+    // Books that left the listing were deleted on the server
+    int removed = 0;
+    for (uint32_t slot = 0; complete && slot < header_of(catalog)->count; ) {
+        catalog_record *record = record_at(catalog, slot);
+        if (!(record->flags & CATALOG_LISTED)) {
+            // The last record moves into this slot, look at it again
+            remove_record(catalog, record);
+            removed++;
+        } else {
+            slot++;
+        }
+    }
+
+    // The positions of the books just marked stay below listing_count, even if the
+    // listing is unusable
+    if (!complete) {
+        header_of(catalog)->listing_count = (uint32_t)count;
+        invalidate_listing(catalog);
+        return -1;
+    }
+
+    catalog_header *header = header_of(catalog);
+    header->listing_count = (uint32_t)count;
+    snprintf(header->listing_etag, sizeof(header->listing_etag), "%s", etag ? etag : "");
+    header->listing_validated = time(NULL);
+    return removed;
+}
+
+int catalog_store_listing(book_catalog *catalog, const char *json, size_t json_len, const char *etag)
+{
+    if (catalog->fd < 0) {
+        return -1;
+    }
+
+    // The body is not null-terminated on its own
+    char *copy = malloc(json_len + 1);
+    if (!copy) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(copy, json, json_len);
+    copy[json_len] = '\0';
+
+    JSON_Value *value = json_parse_string(copy);
+    free(copy);
+
+    if (catalog_lock(catalog) < 0) {
+        json_value_free(value);
+        return -1;
+    }
+
+    int removed = -1;
+    JSON_Array *books = json_value_get_array(value);
+    if (books) {
+        removed = store_listing(catalog, books, etag);
+    } else {
+        invalidate_listing(catalog);
+    }
+
+    catalog_unlock(catalog);
+    json_value_free(value);
+    return removed;
+}
+
+static void listing_append(book_catalog *catalog, int id, const char *title)
+{
+    if (header_of(catalog)->listing_validated == 0) {
+        return;
+    }
+
+    // A book that can't be listed locally makes the whole listing unusable offline
+    catalog_record *record = id > 0 && title && strlen(title) < CATALOG_TITLE_LEN ? find_record(catalog, id) : NULL;
+    if (!record && id > 0 && title && strlen(title) < CATALOG_TITLE_LEN) {
+        record = add_record(catalog, id);
+    }
+    if (!record || (record->flags & CATALOG_LISTED)) {
+        invalidate_listing(catalog);
+        return;
+    }
+
+    // New books come last, as in the server's listing
+    snprintf(record->title, sizeof(record->title), "%s", title);
+    record->listing_pos = header_of(catalog)->listing_count++;
+    record->flags |= CATALOG_LISTED;
+}
+
+void catalog_listing_append(book_catalog *catalog, int id, const char *title)
+{
+    if (catalog_lock(catalog) < 0) {
+        return;
+    }
+
+    listing_append(catalog, id, title);
+    catalog_unlock(catalog);
+}
+
+void catalog_expire_listing(book_catalog *catalog)
+{
+    // Keep the listing and its ETag, but revalidate it before using it again
+    if (catalog_lock(catalog) == 0) {
+        header_of(catalog)->listing_validated = 0;
+        catalog_unlock(catalog);
+    }
+}
+
+void catalog_touch_listing(book_catalog *catalog)
+{
+    if (catalog_lock(catalog) == 0) {
+        if (header_of(catalog)->listing_validated != 0) {
+            header_of(catalog)->listing_validated = time(NULL);
+        }
+        catalog_unlock(catalog);
+    }
+}
+
+char *catalog_build_listing(book_catalog *catalog)
+{
+    // An empty listing if the catalog can't be read
+    if (catalog_lock(catalog) < 0) {
+        JSON_Value *empty = json_value_init_array();
+        char *listing = json_serialize_to_string(empty);
+        json_value_free(empty);
+        return listing;
+    }
+
+    catalog_header *header = header_of(catalog);
+
+    // A damaged count can't be larger than the file, which has room for every position
+    uint32_t listing_count = header->listing_count <= header->capacity ? header->listing_count : header->capacity;
+
+    // Put the listed books back in the order the server sent them
+    const catalog_record **ordered = calloc(listing_count + 1, sizeof(catalog_record *));
+    if (!ordered) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    for (uint32_t slot = 0; slot < header->count; slot++) {
+        const catalog_record *record = record_at(catalog, slot);
+        if ((record->flags & CATALOG_LISTED) && record->listing_pos < listing_count &&
+            record_is_valid(header, record)) {
+            ordered[record->listing_pos] = record;
+        }
+    }
+
+    // Same shape as the server's listing: [{"id":..,"title":..}, ...]
+    JSON_Value *value = json_value_init_array();
+    JSON_Array *books = json_value_get_array(value);
+    for (uint32_t i = 0; i < listing_count; i++) {
+        if (!ordered[i]) {
+            continue;
+        }
+        JSON_Value *book = json_value_init_object();
+        json_object_set_number(json_value_get_object(book), "id", ordered[i]->id);
+        json_object_set_string(json_value_get_object(book), "title", ordered[i]->title);
+        json_array_append_value(books, book);
+    }
+
+    catalog_unlock(catalog);
+
+    char *listing = json_serialize_to_string(value);
+    json_value_free(value);
+    free(ordered);
+    return listing;
+}
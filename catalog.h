@@ -0,0 +1,109 @@
+#ifndef CATALOG_H_
+#define CATALOG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "cache.h"
+
+// On-disk catalog of one user's library: a memory-mapped file made of a header
+// followed by fixed-size book records, plus an id -> record index kept in memory.
+// Clients of the same user share the file: every access holds a lock on it, and a
+// client remaps the file and rebuilds its index when another one changed them
+
+#define CATALOG_MAGIC "BOOKCAT1"
+#define CATALOG_RECORD_SIZE 1024
+#define CATALOG_TITLE_LEN 256
+#define CATALOG_BODY_LEN (CATALOG_RECORD_SIZE - 24 - ETAG_LEN - DATE_LEN - CATALOG_TITLE_LEN)
+
+#define CATALOG_LISTED 1  // the book is part of the stored get_books listing
+#define CATALOG_DETAILS 2 // the get_book body of the book is stored
+
+// First CATALOG_RECORD_SIZE bytes of the file
+typedef struct {
+    char magic[8];                   // CATALOG_MAGIC, not null-terminated
+    uint32_t record_size;            // CATALOG_RECORD_SIZE, guards against layout changes
+    uint32_t capacity;               // record slots in the file
+    uint32_t count;                  // slots in use, always the first ones
+    uint32_t listing_count;          // books in the stored listing
+    int64_t listing_validated;       // when the listing was last received or revalidated, 0 if none
+    char listing_etag[ETAG_LEN];     // ETag of the stored listing
+    uint32_t generation;             // bumped when records are added, moved or removed
+} catalog_header;
+
+// One book, CATALOG_RECORD_SIZE bytes
+typedef struct {
+    int32_t id;                      // book id
+    uint32_t flags;                  // CATALOG_LISTED and/or CATALOG_DETAILS
+    int64_t validated;               // when the details were last received or revalidated
+    uint32_t listing_pos;            // position in the stored listing, if listed
+    uint32_t body_len;               // length of body, if the details are stored
+    char etag[ETAG_LEN];             // validators of the details
+    char last_modified[DATE_LEN];
+    char title[CATALOG_TITLE_LEN];   // title from the listing, if listed
+    char body[CATALOG_BODY_LEN];     // get_book body, if the details are stored
+} catalog_record;
+
+typedef struct {
+    int fd;                 // catalog file, -1 when no catalog is open
+    char *map;              // the whole file, mapped shared
+    size_t map_size;        // bytes mapped
+    uint32_t generation;    // header generation the index was built for
+    int ttl;                // seconds stored data is used without asking the server
+    int32_t *index_ids;     // open addressing index, 0 marks a free position
+    uint32_t *index_slots;  // record slot of the id at the same position
+    size_t index_capacity;  // always a power of two
+} book_catalog;
+
+// marks a catalog as closed, call once before using it
+void catalog_init(book_catalog *catalog);
+
+// opens (creating if needed) the catalog of user in dir; returns 0 on success, -1 if the
+// catalog can't be used, in which case the client simply works without it
+int catalog_open(book_catalog *catalog, const char *dir, const char *user, int ttl);
+
+// unmaps and closes the catalog, if open
+void catalog_close(book_catalog *catalog);
+
+// copies the record of a book into record; returns 1 if there is one, 0 otherwise. A copy,
+// since another client of the user may move the records as soon as the file is unlocked
+int catalog_find(book_catalog *catalog, int id, catalog_record *record);
+
+// stores the get_book body of a book with its validators (which can be NULL)
+void catalog_store_book(book_catalog *catalog, int id, const char *body, size_t body_len,
+                        const char *etag, const char *last_modified);
+
+// marks the stored details of a book as just confirmed by the server
+void catalog_touch_book(book_catalog *catalog, int id);
+
+// forgets a book, taking it out of the stored listing as well
+void catalog_remove_book(book_catalog *catalog, int id);
+
+// checks if a listing is stored and young enough to be used without asking the server
+int catalog_listing_is_fresh(book_catalog *catalog);
+
+// returns when the stored listing was last received or revalidated, 0 if it is stale
+time_t catalog_listing_validated(book_catalog *catalog);
+
+// copies the ETag of the stored listing into etag (size bytes, ETAG_LEN holds any);
+// returns 0, with etag empty, if there is none
+int catalog_listing_etag(book_catalog *catalog, char *etag, size_t size);
+
+// replaces the stored listing with the JSON array returned by get_books; books missing from
+// it are forgotten. Returns how many books were forgotten, or -1 if the listing can't be stored
+int catalog_store_listing(book_catalog *catalog, const char *json, size_t json_len, const char *etag);
+
+// adds a book just created on the server at the end of the stored listing
+void catalog_listing_append(book_catalog *catalog, int id, const char *title);
+
+// makes the stored listing stale, so it is revalidated the next time it is needed
+void catalog_expire_listing(book_catalog *catalog);
+
+// marks the stored listing as just confirmed by the server
+void catalog_touch_listing(book_catalog *catalog);
+
+// rebuilds the stored listing as a JSON string, free it with json_free_serialized_string
+char *catalog_build_listing(book_catalog *catalog);
+
+#endif
@@ -0,0 +1,173 @@
+#include <string.h>
+
+#include "chacha.h"
+
+#define ROTATE(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+#define QUARTER_ROUND(x, a, b, c, d)                      \
+    do {                                                  \
+        x[a] += x[b]; x[d] ^= x[a]; x[d] = ROTATE(x[d], 16); \
+        x[c] += x[d]; x[b] ^= x[c]; x[b] = ROTATE(x[b], 12); \
+        x[a] += x[b]; x[d] ^= x[a]; x[d] = ROTATE(x[d], 8);  \
+        x[c] += x[d]; x[b] ^= x[c]; x[b] = ROTATE(x[b], 7);  \
+    } while (0)
+
+static uint32_t load32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+// one 64-byte block of the key stream for state
+static void chacha20_block(const uint32_t state[16], uint8_t stream[64])
+{
+    uint32_t x[16];
+    for (int i = 0; i < 16; i++) {
+        x[i] = state[i];
+    }
+
+    // 20 rounds: a column round and a diagonal round at a time
+    for (int i = 0; i < 10; i++) {
+        QUARTER_ROUND(x, 0, 4, 8, 12);
+        QUARTER_ROUND(x, 1, 5, 9, 13);
+        QUARTER_ROUND(x, 2, 6, 10, 14);
+        QUARTER_ROUND(x, 3, 7, 11, 15);
+        QUARTER_ROUND(x, 0, 5, 10, 15);
+        QUARTER_ROUND(x, 1, 6, 11, 12);
+        QUARTER_ROUND(x, 2, 7, 8, 13);
+        QUARTER_ROUND(x, 3, 4, 9, 14);
+    }
+
+    // Serialized little-endian
+    for (int i = 0; i < 16; i++) {
+        uint32_t word = x[i] + state[i];
+        stream[4 * i] = (uint8_t)word;
+        stream[4 * i + 1] = (uint8_t)(word >> 8);
+        stream[4 * i + 2] = (uint8_t)(word >> 16);
+        stream[4 * i + 3] = (uint8_t)(word >> 24);
+    }
+}
+
+void chacha20_xor(const uint8_t key[CHACHA_KEY_SIZE], const uint8_t nonce[CHACHA_NONCE_SIZE],
+                  uint32_t counter, uint8_t *data, size_t size)
+{
+    // "expand 32-byte k", the key, the block counter and the nonce
+    uint32_t state[16] = { 0x61707865, 0x3320646e, 0x79622d32, 0x6b206574 };
+    for (int i = 0; i < 8; i++) {
+        state[4 + i] = load32(key + 4 * i);
+    }
+    state[12] = counter;
+    for (int i = 0; i < 3; i++) {
+        state[13 + i] = load32(nonce + 4 * i);
+    }
+
+    uint8_t stream[64];
+    while (size > 0) {
+        chacha20_block(state, stream);
+        state[12]++;
+
+        size_t chunk = size < sizeof(stream) ? size : sizeof(stream);
+        for (size_t i = 0; i < chunk; i++) {
+            data[i] ^= stream[i];
+        }
+        data += chunk;
+        size -= chunk;
+    }
+}
+
+static void store32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+void poly1305_mac(const uint8_t key[POLY1305_KEY_SIZE], const uint8_t *data, size_t size,
+                  uint8_t tag[POLY1305_TAG_SIZE])
+{
+    const uint32_t mask = 0x3ffffff;
+
+    // r, clamped, and the accumulator h in 26-bit limbs
+    uint32_t r0 = load32(key) & 0x3ffffff;
+    uint32_t r1 = (load32(key + 3) >> 2) & 0x3ffff03;
+    uint32_t r2 = (load32(key + 6) >> 4) & 0x3ffc0ff;
+    uint32_t r3 = (load32(key + 9) >> 6) & 0x3f03fff;
+    uint32_t r4 = (load32(key + 12) >> 8) & 0x00fffff;
+    uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = 0, h1 = 0, h2 = 0, h3 = 0, h4 = 0;
+
+    while (size > 0) {
+        // A short last block is padded with a 1 byte instead of getting the high bit
+        uint8_t block[16] = { 0 };
+        size_t chunk = size < sizeof(block) ? size : sizeof(block);
+        memcpy(block, data, chunk);
+        uint32_t high = 1u << 24;
+        if (chunk < sizeof(block)) {
+            block[chunk] = 1;
+            high = 0;
+        }
+        data += chunk;
+        size -= chunk;
+
+        h0 += load32(block) & mask;
+        h1 += (load32(block + 3) >> 2) & mask;
+        h2 += (load32(block + 6) >> 4) & mask;
+        h3 += (load32(block + 9) >> 6) & mask;
+        h4 += (load32(block + 12) >> 8) | high;
+
+        // h *= r modulo 2^130 - 5
+        uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+        uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+        uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+        uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+        uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+        uint32_t c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & mask;
+        d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & mask;
+        d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & mask;
+        d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & mask;
+        d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & mask;
+        h0 += c * 5; c = h0 >> 26; h0 &= mask;
+        h1 += c;
+    }
+
+    // Fully carried, then reduced: h - p is taken when it doesn't go negative
+    uint32_t c = h1 >> 26; h1 &= mask;
+    h2 += c; c = h2 >> 26; h2 &= mask;
+    h3 += c; c = h3 >> 26; h3 &= mask;
+    h4 += c; c = h4 >> 26; h4 &= mask;
+    h0 += c * 5; c = h0 >> 26; h0 &= mask;
+    h1 += c;
+
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= mask;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= mask;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= mask;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= mask;
+    uint32_t g4 = h4 + c - (1u << 26);
+
+    uint32_t select = (g4 >> 31) - 1;
+    h0 = (h0 & ~select) | (g0 & select);
+    h1 = (h1 & ~select) | (g1 & select);
+    h2 = (h2 & ~select) | (g2 & select);
+    h3 = (h3 & ~select) | (g3 & select);
+    h4 = (h4 & ~select) | (g4 & select);
+
+    // tag = (h + s) modulo 2^128
+    uint64_t f = (uint64_t)(h0 | h1 << 26) + load32(key + 16);
+    store32(tag, (uint32_t)f);
+    f = (uint64_t)(h1 >> 6 | h2 << 20) + load32(key + 20) + (f >> 32);
+    store32(tag + 4, (uint32_t)f);
+    f = (uint64_t)(h2 >> 12 | h3 << 14) + load32(key + 24) + (f >> 32);
+    store32(tag + 8, (uint32_t)f);
+    f = (uint64_t)(h3 >> 18 | h4 << 8) + load32(key + 28) + (f >> 32);
+    store32(tag + 12, (uint32_t)f);
+}
+
+int poly1305_equal(const uint8_t a[POLY1305_TAG_SIZE], const uint8_t b[POLY1305_TAG_SIZE])
+{
+    uint8_t diff = 0;
+    for (int i = 0; i < POLY1305_TAG_SIZE; i++) {
+        diff |= a[i] ^ b[i];
+    }
+    return diff == 0;
+}
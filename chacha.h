@@ -0,0 +1,26 @@
+#ifndef CHACHA_H_
+#define CHACHA_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define CHACHA_KEY_SIZE 32
+#define CHACHA_NONCE_SIZE 12
+#define POLY1305_KEY_SIZE 32
+#define POLY1305_TAG_SIZE 16
+
+// encrypts (or decrypts, it is the same) size bytes of data in place with the ChaCha20
+// stream of RFC 8439 for key and nonce, starting at block counter; a nonce must never
+// be used twice with the same key
+void chacha20_xor(const uint8_t key[CHACHA_KEY_SIZE], const uint8_t nonce[CHACHA_NONCE_SIZE],
+                  uint32_t counter, uint8_t *data, size_t size);
+
+// computes the Poly1305 tag of size bytes of data for a one-time key (RFC 8439); a key
+// must never authenticate two messages, so it is taken from the ChaCha20 block 0 of a nonce
+void poly1305_mac(const uint8_t key[POLY1305_KEY_SIZE], const uint8_t *data, size_t size,
+                  uint8_t tag[POLY1305_TAG_SIZE]);
+
+// compares two tags in a time that doesn't depend on where they differ; 1 if they are equal
+int poly1305_equal(const uint8_t a[POLY1305_TAG_SIZE], const uint8_t b[POLY1305_TAG_SIZE]);
+
+#endif
@@ -1,145 +1,357 @@
+#define _POSIX_C_SOURCE 200809L
+
 #include <stdio.h>
-#include "functions.h"
+#include <signal.h>
+#include <fcntl.h>
+#include <time.h>
+#include "commands.h"
 
-int parse_from_string(char *command)
+// joins count words into a new string, separated by spaces
+static char *join_words(char **words, int count)
 {
-    if (!strcmp(command, "register"))
+    size_t size = 1;
+    for (int i = 0; i < count; i++) {
+        size += strlen(words[i]) + 1;
+    }
+
+    char *joined = malloc(size);
+    if (!joined) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    char *end = joined;
+    for (int i = 0; i < count; i++) {
+        if (i > 0) {
+            *end++ = ' ';
+        }
+        size_t len = strlen(words[i]);
+        memcpy(end, words[i], len);
+        end += len;
+    }
+    *end = '\0';
+    return joined;
+}
+
+// a session restored from the session file is only checked by the first request that uses it
+static void check_restored_session(client_state *state, const command *cmd)
+{
+    int status = state->conn.status;
+    if (!state->restored || cmd->session < SESSION_LOGGED_IN || status == 0) {
+        return;
+    }
+
+    if (status == 401) {
+        out_printf("The stored session has expired, please log in again!\n");
+        drop_session(state);
+    } else if (status == 403 && state->token) {
+        out_printf("The stored library access has expired, please enter the library again!\n");
+        free(state->token);
+        state->token = NULL;
+    } else if (status < 400) {
+        state->restored = 0;
+    }
+}
+
+// runs a command and its arguments in the active session; returns 1 when the client should stop
+static int run_in_session(client_state *state, char **words, int count)
+{
+    const command *cmd = find_command(words[0]);
+    if (!cmd) {
+        out_printf("Unknown command!\n");
         return 0;
-    
-    if (!strcmp(command, "login"))
-        return 1;
-
-    if (!strcmp(command, "get_book"))
-        return 2;
-
-    if (!strcmp(command, "get_books"))
-        return 3;
-
-    if (!strcmp(command, "enter_library"))
-        return 4;
-
-    if (!strcmp(command, "add_book"))
-        return 5;
-    
-    if (!strcmp(command, "delete_book"))
-        return 6;
-    
-    if (!strcmp(command, "logout"))
-        return 7;
-    
-    if (!strcmp(command, "exit"))
-        return 8;
-    
-    return 9;
+    }
+
+    // the words after the command name answer its prompts
+    int arg_count = count - 1;
+    char *rest = NULL;
+    if (arg_count > cmd->arg_count) {
+        if (!cmd->rest) {
+            out_printf("Usage: %s%s%s\n", cmd->name, cmd->arg_count ? " " : "", cmd->args);
+            return 0;
+        }
+        rest = join_words(words + cmd->arg_count, arg_count - cmd->arg_count + 1);
+        arg_count = cmd->arg_count;
+    }
+
+    char *args[MAX_ARGS];
+    for (int i = 0; i < arg_count; i++) {
+        args[i] = words[i + 1];
+    }
+    if (rest) {
+        args[arg_count - 1] = rest;
+    }
+    input_set_args(args, arg_count);
+
+    // books prefetched since the last command are stored before it runs
+    prefetch_collect(&state->prefetcher, &state->cache, &state->catalog);
+
+    int stop = 0;
+
+    // the session the command needs
+    if (cmd->session == SESSION_LOGGED_OUT && state->cookie) {
+        out_printf("%s\n", cmd->refusal);
+    } else if (cmd->session >= SESSION_LOGGED_IN && !state->cookie) {
+        out_printf("%s\n", cmd->refusal);
+    } else if (cmd->session == SESSION_TOKEN && !state->token) {
+        out_printf("Invalid token!\n");
+    } else {
+        // a token about to expire is renewed before the command sends it
+        if (cmd->session >= SESSION_LOGGED_IN) {
+            refresh_token(&state->refresher, state->cookie, &state->token);
+        }
+
+        // the connection is opened by the first request the command sends
+        stop = cmd->handler(state, &state->conn);
+        check_restored_session(state, cmd);
+
+        // and one that expires soon is renewed on an idle thread before the next command
+        refresh_ahead(&state->refresher, state->cookie, state->token);
+    }
+
+    // login, enter_library and logout are kept for the next run, only named sessions aren't
+    if (state->sessions.active == 0) {
+        session_update(&state->session, state->user, state->cookie, state->token);
+    }
+
+    conn_done(&state->conn);
+    input_set_args(NULL, 0);
+    free(rest);
+    return stop;
 }
 
-int main(void)
+// runs a command in the named session at index; login and session without arguments
+// use the credentials given by --users
+static int run_named(client_state *state, size_t index, char **words, int count)
 {
-    char command[NMAX];
-    char *cookie = NULL, *token = NULL;
+    use_session(state, index);
+
+    named_session *session = &state->sessions.entries[index];
+    if (count == 1 && session->password[0] &&
+        (!strcmp(words[0], "login") || !strcmp(words[0], "session"))) {
+        char *login[] = { words[0], session->user, session->password };
+        return run_in_session(state, login, 3);
+    }
+
+    return run_in_session(state, words, count);
+}
+
+// runs a command prefixed with @name in that session, or with @* in every named session
+static int run_routed(client_state *state, char **words, int count)
+{
+    const char *name = words[0] + 1;
+    if (count < 2 || *name == '\0') {
+        out_printf("Usage: @name command, or @* command\n");
+        return 0;
+    }
+
+    // a name that isn't known yet starts a logged out session
+    if (strcmp(name, "*")) {
+        return run_named(state, sessions_add(&state->sessions, name), words + 1, count - 1);
+    }
+
+    session_table *table = &state->sessions;
+    if (table->count < 2) {
+        out_printf("No named sessions!\n");
+        return 0;
+    }
+
+    // session, get_books and logout send the requests of every session at once
+    sessions_action action;
+    if (count == 2 && sessions_action_of(words[1], &action)) {
+        use_session(state, 0);
+        sessions_run_all(table, action, &state->pool, &state->engine);
+        return 0;
+    }
 
-    while (fgets(command, NMAX, stdin)) {
-        size_t len = strlen(command);
-        if (len > 0 && command[len - 1] == '\n') {
-            command[len - 1] = '\0';
+    // other commands run in one session after the other
+    for (size_t i = 1; i < table->count; i++) {
+        out_printf("[%s]\n", table->entries[i].name);
+        if (run_named(state, i, words + 1, count - 1)) {
+            return 1;
         }
+    }
+    return 0;
+}
 
-        // open a new connection - HTTP is stateless
-        int sockfd = open_connection((char *)IP, PORT, AF_INET, SOCK_STREAM, 0);
-
-        // each command type
-        int command_type = parse_from_string(command);
-        switch (command_type) {
-            case 0:
-                if (cookie) {
-                    printf("User is already logged in!\n");
-                } else {
-                    register_user(sockfd);
-                }
-                break;
+// runs a command and its arguments, in the session it is routed to; returns 1 when the
+// client should stop
+static int run_words(client_state *state, char **words, int count)
+{
+    if (words[0][0] == '@') {
+        return run_routed(state, words, count);
+    }
 
-            case 1:
-                if (!cookie) {
-                    cookie = login(sockfd, cookie);
-                } else {
-                    free(cookie);
-                    cookie = login(sockfd, cookie);
-                }
-                break;
+    // commands without @name run in the default session
+    use_session(state, 0);
+    return run_in_session(state, words, count);
+}
 
-            case 2:
-                if (!cookie) {
-                    printf("User not logged in!\n");
-                } else {
-                    get_book(sockfd, token);
-                }
-                break;
+// runs one command line; returns 1 when the client should stop
+static int run_command(client_state *state, char *line)
+{
+    char *words[MAX_ARGS];
+    int count = split_command_line(line, words, MAX_ARGS);
+    if (count == 0) {
+        return 0;
+    }
 
-            case 3:
-                if (!cookie) {
-                    printf("User not logged in!\n");
-                } else {
-                    get_books(sockfd, token);
-                }
-                break;
+    return run_words(state, words, count);
+}
 
-            case 4:
-                if (!cookie) {
-                    printf("User not logged in!\n");
-                } else {
-                    char *tmp = enter_library(sockfd, cookie);
-                    if (tmp) {
-                        free(token);
-                        token = tmp;
-                    }
-                }
-                break;
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
 
-            case 5:
-                if (!cookie) {
-                    printf("User not logged in!\n");
-                } else {
-                    add_book(sockfd, token);
-                }
-                break;
+// runs the commands of a batch file ("-" for stdin) without prompting
+static void run_batch(client_state *state, const char *path)
+{
+    int fd = strcmp(path, "-") ? open(path, O_RDONLY) : 0;
+    line_reader reader;
 
-            case 6:
-                if (!cookie) {
-                    printf("User not logged in!\n");
-                } else if (!token) {
-                    printf("Invalid token!\n");
-                } else {
-                    delete_book(sockfd, token);
-                }
-                break;
+    if (fd < 0 || line_reader_init(&reader, fd) < 0) {
+        perror(path);
+        exit(EXIT_FAILURE);
+    }
 
-            case 7:
-                if (!cookie) {
-                    printf("User already logged out!\n");
-                } else {
-                    logout(sockfd, cookie);
-                    free(cookie);
-                    free(token);
-                    token = NULL;
-                    cookie = NULL;
-                }
-                break;
+    // missing arguments are reported instead of asked for, and the output is
+    // only written when the buffer fills up
+    input_set_batch(1);
+    size_t commands = 0;
+    double start = now_seconds();
 
-            case 8:
-                exit_client(sockfd);
-                break;
+    char *line;
+    while ((line = line_reader_next(&reader)) != NULL) {
+        // blank lines and # comments are skipped
+        char *text = line + strspn(line, " \t");
+        if (*text == '\0' || *text == '#') {
+            continue;
+        }
 
-            case 9:
-                break;
+        commands++;
+        if (run_command(state, text)) {
+            break;
+        }
+    }
 
-            default:
-                printf("Unknown command!\n");
-                break;
+    double elapsed = now_seconds() - start;
+    out_flush();
+    fprintf(stderr, "Ran %zu commands in %.2f s (%.1f commands/s)\n",
+            commands, elapsed, elapsed > 0 ? commands / elapsed : 0.0);
+
+    line_reader_destroy(&reader);
+    if (fd != 0) {
+        close(fd);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    char command[NMAX];
+    client_state state;
+
+    // read the command line settings and set up the book cache
+    parse_options(argc, argv, &state.options);
+    state.cookie = NULL;
+    state.token = NULL;
+    state.user[0] = '\0';
+    state.restored = 0;
+    sessions_init(&state.sessions);
+    cache_init(&state.cache, state.options.cache_size, state.options.cache_ttl, state.options.missing_ttl);
+    catalog_init(&state.catalog);
+
+    // a session kept by an earlier run is used without logging in again
+    if (session_open(&state.session, state.options.session, state.options.session_key) == 0 &&
+        session_load(&state.session, state.user, sizeof(state.user), &state.cookie, &state.token) == 0) {
+        state.restored = 1;
+        if (state.options.catalog_dir) {
+            catalog_open(&state.catalog, state.options.catalog_dir, state.user, state.options.cache_ttl);
         }
+    }
+
+    // named sessions, with the credentials @* session logs them in with
+    if (state.options.users && sessions_load(&state.sessions, state.options.users) < 0) {
+        perror(state.options.users);
+        exit(EXIT_FAILURE);
+    }
+
+    // sync sends its requests from a few threads over kept-alive connections
+    pool_init(&state.pool, IP, PORT, state.options.jobs);
+    engine_start(&state.engine, state.options.jobs);
+    // get_books can fetch the listed books in the background on idle threads
+    prefetch_init(&state.prefetcher, &state.pool, &state.engine, state.options.prefetch);
+    // bulk commands pipeline their requests on the same threads and connections
+    state.sender.pool = &state.pool;
+    state.sender.engine = &state.engine;
+    state.sender.depth = state.options.pipeline;
+    state.sender.stream = state.options.stream;
+    // commands connect only when they send a request
+    conn_init(&state.conn, IP, PORT);
+    // the library token is renewed from its exp, before the server would refuse it
+    refresh_init(&state.refresher, &state.pool, &state.engine);
+    // a connection the server closed must fail the write, not kill the client
+    signal(SIGPIPE, SIG_IGN);
+    // output still buffered when a fatal error exits is written too
+    atexit(out_flush);
+
+    // share repeated keys (e.g. "id" and "title" in listings) while parsing
+    json_set_key_interning(1);
+    // recycle JSON nodes between commands instead of going back to malloc
+    json_set_node_pooling(1);
+
+    if (state.options.command) {
+        // a single command from the command line, e.g. client --session FILE get_books
+        input_set_batch(1);
+        run_words(&state, state.options.command, state.options.command_count);
+    } else if (state.options.batch) {
+        run_batch(&state, state.options.batch);
+    } else {
+        // the first command's connection is set up while the user types it
+        if (state.options.preconnect) {
+            conn_preconnect(&state.conn);
+        }
+
+        while (fgets(command, NMAX, stdin)) {
+            size_t len = strlen(command);
+            if (len > 0 && command[len - 1] == '\n') {
+                command[len - 1] = '\0';
+            }
+
+            int stop = run_command(&state, command);
+            // the answer is shown as soon as the command is done
+            out_flush();
+            if (stop) {
+                break;
+            }
 
-        // Close the connection on the TCP socket.
-        close_connection(sockfd);
+            // and so is the next one's, unless the last command didn't use it
+            if (state.options.preconnect) {
+                conn_preconnect(&state.conn);
+            }
+        }
     }
 
+    prefetch_cancel(&state.prefetcher);
+    refresh_cancel(&state.refresher);
+    engine_stop(&state.engine);
+    prefetch_destroy(&state.prefetcher);
+    refresh_destroy(&state.refresher);
+    // counted once the workers are gone
+    if (state.options.stats) {
+        conn_print_stats(&state.conn);
+        fprintf(stderr, "Pooled connections: %zu opened, %zu reused\n", state.pool.opened, state.pool.reused);
+        fprintf(stderr, "Library tokens renewed: %zu\n", state.refresher.renewed);
+    }
+    pool_destroy(&state.pool);
+    conn_destroy(&state.conn);
+    cache_destroy(&state.cache);
+    catalog_close(&state.catalog);
+    session_close(&state.session);
+    sessions_destroy(&state.sessions);
+    free(state.cookie);
+    free(state.token);
     return 0;
 }
@@ -0,0 +1,181 @@
+#include "commands.h"
+
+void drop_session(client_state *state)
+{
+    prefetch_cancel(&state->prefetcher);
+    refresh_cancel(&state->refresher);
+    cache_clear(&state->cache);
+    catalog_close(&state->catalog);
+    free(state->cookie);
+    free(state->token);
+    state->token = NULL;
+    state->cookie = NULL;
+    state->restored = 0;
+}
+
+void use_session(client_state *state, size_t index)
+{
+    session_table *table = &state->sessions;
+    if (index == table->active) {
+        return;
+    }
+
+    // The active session goes back to its entry
+    named_session *from = &table->entries[table->active];
+    memcpy(from->user, state->user, sizeof(from->user));
+    from->cookie = state->cookie;
+    from->token = state->token;
+    from->restored = state->restored;
+
+    named_session *to = &table->entries[index];
+    memcpy(state->user, to->user, sizeof(state->user));
+    state->cookie = to->cookie;
+    state->token = to->token;
+    state->restored = to->restored;
+    to->cookie = NULL;
+    to->token = NULL;
+    table->active = index;
+
+    // The renewal in flight and the books in memory belong to the other session
+    prefetch_cancel(&state->prefetcher);
+    refresh_cancel(&state->refresher);
+    cache_clear(&state->cache);
+    catalog_close(&state->catalog);
+    if (state->cookie && state->options.catalog_dir) {
+        catalog_open(&state->catalog, state->options.catalog_dir, state->user, state->options.cache_ttl);
+    }
+}
+
+// The session checks listed in tools/gen_dispatch.py were done before these run
+
+int command_register(client_state *state, server_conn *conn)
+{
+    (void)state;
+    register_user(conn);
+    return 0;
+}
+
+// sets up the books of the user who just logged in
+static void start_user(client_state *state)
+{
+    // books cached for the previous user must not be shown to this one
+    prefetch_cancel(&state->prefetcher);
+    cache_clear(&state->cache);
+    // books kept on disk by earlier runs of this user are reused
+    if (state->options.catalog_dir) {
+        catalog_open(&state->catalog, state->options.catalog_dir, state->user, state->options.cache_ttl);
+    }
+}
+
+int command_login(client_state *state, server_conn *conn)
+{
+    state->cookie = login(conn, state->cookie, state->user);
+    if (state->cookie) {
+        start_user(state);
+    }
+    return 0;
+}
+
+int command_session(client_state *state, server_conn *conn)
+{
+    // A session already there only needs a new library token, which also checks the cookie
+    if (state->cookie) {
+        char *token = renew_library_access(conn, state->cookie);
+        if (token) {
+            free(state->token);
+            state->token = token;
+            state->restored = 0;
+            return 0;
+        }
+
+        // Only a refused cookie is worth logging in again for
+        if (conn->status != 401) {
+            return 0;
+        }
+        out_printf("The session has expired, logging in again\n");
+        drop_session(state);
+    }
+
+    char *token = NULL;
+    state->cookie = start_session(conn, state->user, &token);
+    if (state->cookie) {
+        state->token = token;
+        start_user(state);
+    }
+    return 0;
+}
+
+int command_get_book(client_state *state, server_conn *conn)
+{
+    get_book(conn, state->token, &state->cache, &state->catalog, &state->sender);
+    return 0;
+}
+
+int command_get_books(client_state *state, server_conn *conn)
+{
+    get_books(conn, state->token, &state->cache, &state->catalog, &state->prefetcher);
+    return 0;
+}
+
+int command_enter_library(client_state *state, server_conn *conn)
+{
+    char *tmp = enter_library(conn, state->cookie);
+    if (tmp) {
+        free(state->token);
+        state->token = tmp;
+    }
+    return 0;
+}
+
+int command_add_book(client_state *state, server_conn *conn)
+{
+    add_book(conn, state->token, &state->cache, &state->catalog);
+    return 0;
+}
+
+int command_delete_book(client_state *state, server_conn *conn)
+{
+    delete_book(conn, state->token, &state->cache, &state->catalog);
+    return 0;
+}
+
+int command_logout(client_state *state, server_conn *conn)
+{
+    logout(conn, state->cookie);
+    drop_session(state);
+    return 0;
+}
+
+int command_exit(client_state *state, server_conn *conn)
+{
+    (void)state;
+    (void)conn;
+    return 1;
+}
+
+int command_sync(client_state *state, server_conn *conn)
+{
+    sync_books(conn, state->token, &state->cache, &state->catalog, &state->pool, &state->engine);
+    return 0;
+}
+
+int command_add_books(client_state *state, server_conn *conn)
+{
+    (void)conn;
+    char path[NMAX];
+    if (input_read("file=", path, sizeof(path)) == 0) {
+        add_books(path, state->token, &state->cache, &state->catalog, &state->sender);
+    }
+    return 0;
+}
+
+int command_delete_books(client_state *state, server_conn *conn)
+{
+    (void)conn;
+    // ids and ranges, e.g. 3,7,10-20 or all
+    char ids[NMAX];
+    if (input_read("ids=", ids, sizeof(ids)) == 0) {
+        delete_books(ids, state->token, &state->cache, &state->catalog, &state->sender);
+    }
+    return 0;
+}
@@ -0,0 +1,78 @@
+#ifndef COMMANDS_H_
+#define COMMANDS_H_
+
+#include <stddef.h>
+
+#include "functions.h"
+#include "options.h"
+#include "session.h"
+#include "refresh.h"
+#include "sessions.h"
+
+// Everything a command can use or change
+typedef struct {
+    client_options options;
+    char *cookie;          // session cookie, NULL when logged out
+    char *token;           // library access token, NULL before enter_library
+    char user[NMAX];       // user of the session
+    book_cache cache;
+    book_catalog catalog;
+    connection_pool pool;
+    task_engine engine;
+    book_prefetcher prefetcher;
+    bulk_sender sender;
+    server_conn conn;      // connection of the command being run
+    session_store session; // where the session is kept between runs
+    token_refresher refresher; // renews the library token before it expires
+    int restored;          // the session came from the session file and no request accepted it yet
+    session_table sessions; // named sessions commands can be routed to, the active one is above
+} client_state;
+
+// Session a command needs before it runs
+typedef enum {
+    SESSION_ANY,           // runs in any state (exit, session)
+    SESSION_LOGGED_OUT,    // only without a session (register, login)
+    SESSION_LOGGED_IN,     // needs the session cookie
+    SESSION_TOKEN,         // needs the cookie and the library token
+} session_state;
+
+// runs a command, its arguments are read with input_read and conn is only connected
+// if it needs the server; returns 1 when the client should stop
+typedef int (*command_handler)(client_state *state, server_conn *conn);
+
+// One entry of the dispatch table generated by tools/gen_dispatch.py
+typedef struct {
+    const char *name;
+    command_handler handler;
+    session_state session;
+    const char *refusal;   // printed instead of running when the session doesn't match
+    const char *args;      // names of the values it reads, in order (e.g. "title author")
+    int arg_count;         // how many values may follow the command name
+    int rest;              // the last value takes the rest of the line (e.g. "3,7 10-20")
+} command;
+
+// finds the command called name with one hash and one comparison; NULL if there is none
+const command *find_command(const char *name);
+
+// forgets the session: cookie, token and the books cached for its user
+void drop_session(client_state *state);
+
+// makes the session at index of state->sessions the one commands run in, keeping the
+// user, cookie and token of the active one in its entry
+void use_session(client_state *state, size_t index);
+
+int command_register(client_state *state, server_conn *conn);
+int command_login(client_state *state, server_conn *conn);
+int command_session(client_state *state, server_conn *conn);
+int command_get_book(client_state *state, server_conn *conn);
+int command_get_books(client_state *state, server_conn *conn);
+int command_enter_library(client_state *state, server_conn *conn);
+int command_add_book(client_state *state, server_conn *conn);
+int command_delete_book(client_state *state, server_conn *conn);
+int command_logout(client_state *state, server_conn *conn);
+int command_exit(client_state *state, server_conn *conn);
+int command_sync(client_state *state, server_conn *conn);
+int command_add_books(client_state *state, server_conn *conn);
+int command_delete_books(client_state *state, server_conn *conn);
+
+#endif
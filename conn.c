@@ -0,0 +1,183 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#include "conn.h"
+#include "helpers.h"
+#include "http.h"
+
+static double now_seconds(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+void conn_init(server_conn *conn, const char *host, int port)
+{
+    snprintf(conn->host, sizeof(conn->host), "%s", host);
+    conn->port = port;
+    conn->sockfd = -1;
+    conn->spare = -1;
+    conn->status = 0;
+    conn->answered = 0;
+    memset(&conn->stats, 0, sizeof(conn->stats));
+}
+
+void conn_preconnect(server_conn *conn)
+{
+    if (conn->spare >= 0) {
+        return;
+    }
+
+    int sockfd = socket(AF_INET, SOCK_STREAM, 0);
+    if (sockfd < 0) {
+        return;
+    }
+
+    struct sockaddr_in serv_addr;
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = AF_INET;
+    serv_addr.sin_port = htons(conn->port);
+    inet_pton(AF_INET, conn->host, &serv_addr.sin_addr);
+
+    // The handshake goes on in the kernel while connect returns right away
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) | O_NONBLOCK);
+    if (connect(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0 && errno != EINPROGRESS) {
+        close(sockfd);
+        return;
+    }
+
+    conn->spare = sockfd;
+}
+
+// waits for the spare connection to be established; returns 0 if it can carry a request
+static int finish_spare(int sockfd)
+{
+    struct pollfd pfd = { .fd = sockfd, .events = POLLOUT };
+    int ready;
+    do {
+        ready = poll(&pfd, 1, -1);
+    } while (ready < 0 && errno == EINTR);
+
+    int err = 0;
+    socklen_t len = sizeof(err);
+    if (ready < 0 || getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &err, &len) < 0 || err != 0) {
+        return -1;
+    }
+
+    // The server may have dropped it while it waited: a closed connection reads as the end
+    char byte;
+    ssize_t peeked = recv(sockfd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (peeked == 0 || (peeked < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        return -1;
+    }
+
+    fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL) & ~O_NONBLOCK);
+    return 0;
+}
+
+int conn_fd(server_conn *conn)
+{
+    if (conn->sockfd >= 0) {
+        return conn->sockfd;
+    }
+
+    double start = now_seconds();
+    conn->answered = 0;
+
+    // Use the connection opened ahead if it made it
+    if (conn->spare >= 0) {
+        int sockfd = conn->spare;
+        conn->spare = -1;
+
+        if (finish_spare(sockfd) == 0) {
+            conn->sockfd = sockfd;
+            conn->stats.speculative++;
+            conn->stats.speculative_wait += now_seconds() - start;
+            return sockfd;
+        }
+
+        close_connection(sockfd);
+        conn->stats.discarded++;
+    }
+
+    conn->sockfd = open_connection(conn->host, conn->port, AF_INET, SOCK_STREAM, 0);
+    conn->stats.lazy++;
+    conn->stats.lazy_wait += now_seconds() - start;
+    return conn->sockfd;
+}
+
+char *conn_receive(server_conn *conn)
+{
+    char *response = receive_from_server(conn_fd(conn));
+    conn->status = http_status(response);
+    conn->answered++;
+    return response;
+}
+
+char *conn_request(server_conn *conn, const char *message)
+{
+    // The server may have closed a connection after its last response
+    if (conn->sockfd >= 0 && conn->answered > 0) {
+        if (try_send_to_server(conn->sockfd, message) == 0) {
+            char *response = try_receive_from_server(conn->sockfd);
+            if (response) {
+                conn->status = http_status(response);
+                conn->answered++;
+                return response;
+            }
+        }
+
+        close_connection(conn->sockfd);
+        conn->sockfd = -1;
+    }
+
+    send_to_server(conn_fd(conn), (char *)message);
+    return conn_receive(conn);
+}
+
+void conn_done(server_conn *conn)
+{
+    conn->stats.commands++;
+    conn->status = 0;
+    conn->answered = 0;
+
+    // HTTP is stateless, the next command gets a new connection
+    if (conn->sockfd < 0) {
+        conn->stats.unused++;
+        return;
+    }
+
+    close_connection(conn->sockfd);
+    conn->sockfd = -1;
+}
+
+void conn_destroy(server_conn *conn)
+{
+    if (conn->spare >= 0) {
+        close_connection(conn->spare);
+        conn->spare = -1;
+    }
+}
+
+void conn_print_stats(const server_conn *conn)
+{
+    const conn_stats *stats = &conn->stats;
+
+    fprintf(stderr, "Commands: %zu, %zu without a connection\n", stats->commands, stats->unused);
+    fprintf(stderr, "Connected on demand: %zu, %.3f ms average wait\n", stats->lazy,
+            stats->lazy ? stats->lazy_wait * 1000 / stats->lazy : 0.0);
+    fprintf(stderr, "Pre-connected: %zu, %.3f ms average wait, %zu discarded\n", stats->speculative,
+            stats->speculative ? stats->speculative_wait * 1000 / stats->speculative : 0.0,
+            stats->discarded);
+}
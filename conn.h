@@ -0,0 +1,53 @@
+#ifndef CONN_H_
+#define CONN_H_
+
+#include <stddef.h>
+
+// What --stats reports, kept apart for the two ways a command gets its connection
+typedef struct {
+    size_t commands;          // commands run
+    size_t unused;            // commands answered without the server
+    size_t lazy;              // connections opened when a command first needed one
+    double lazy_wait;         // seconds commands waited for those
+    size_t speculative;       // connections opened ahead of the command that used them
+    double speculative_wait;  // seconds commands waited for those
+    size_t discarded;         // connections opened ahead that failed or were closed by the server
+} conn_stats;
+
+// The connection of the command being run, opened only when it sends something
+typedef struct {
+    char host[64];         // server address
+    int port;              // server port
+    int sockfd;            // connection of the current command, -1 until it needs one
+    int spare;             // connection started ahead of the next command, -1 if none
+    int status;            // status of the last response the command received, 0 if none
+    int answered;          // responses received on sockfd so far
+    conn_stats stats;
+} server_conn;
+
+void conn_init(server_conn *conn, const char *host, int port);
+
+// starts connecting for the next command without waiting, e.g. while the user types
+void conn_preconnect(server_conn *conn);
+
+// returns the connection of the current command: the spare one if it is usable,
+// otherwise a new one (exits if the server can't be reached, like open_connection)
+int conn_fd(server_conn *conn);
+
+// receives a response on the command's connection (see receive_from_server) and keeps its status
+char *conn_receive(server_conn *conn);
+
+// sends a request on the command's connection and returns the response like conn_receive; a
+// connection that already answered is kept alive for it, and replaced once if the server closed it
+char *conn_request(server_conn *conn, const char *message);
+
+// ends the current command, closing its connection if it had one
+void conn_done(server_conn *conn);
+
+// closes the spare connection
+void conn_destroy(server_conn *conn);
+
+// prints the counts to stderr
+void conn_print_stats(const server_conn *conn);
+
+#endif
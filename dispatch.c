@@ -0,0 +1,51 @@
+// Generated by tools/gen_dispatch.py, edit the command list there and run make dispatch
+
+#include <stdint.h>
+#include <string.h>
+
+#include "commands.h"
+
+#define DISPATCH_SIZE 32
+#define DISPATCH_SEED 10u
+
+// Each command sits in the slot its name hashes to, the others are empty
+static const command commands[DISPATCH_SIZE] = {
+    [2] = { "register", command_register, SESSION_LOGGED_OUT, "User is already logged in!", "username password", 2, 0 },
+    [4] = { "login", command_login, SESSION_LOGGED_OUT, "User is already logged in!", "username password", 2, 0 },
+    [7] = { "get_book", command_get_book, SESSION_LOGGED_IN, "User not logged in!", "ids...", 1, 1 },
+    [8] = { "sync", command_sync, SESSION_LOGGED_IN, "User not logged in!", "", 0, 0 },
+    [10] = { "add_book", command_add_book, SESSION_LOGGED_IN, "User not logged in!", "title author genre publisher page_count", 5, 0 },
+    [12] = { "delete_book", command_delete_book, SESSION_TOKEN, "User not logged in!", "id", 1, 0 },
+    [13] = { "delete_books", command_delete_books, SESSION_LOGGED_IN, "User not logged in!", "ids...", 1, 1 },
+    [15] = { "exit", command_exit, SESSION_ANY, NULL, "", 0, 0 },
+    [17] = { "logout", command_logout, SESSION_LOGGED_IN, "User already logged out!", "", 0, 0 },
+    [23] = { "enter_library", command_enter_library, SESSION_LOGGED_IN, "User not logged in!", "", 0, 0 },
+    [25] = { "session", command_session, SESSION_ANY, NULL, "username password", 2, 0 },
+    [27] = { "add_books", command_add_books, SESSION_LOGGED_IN, "User not logged in!", "file", 1, 0 },
+    [28] = { "get_books", command_get_books, SESSION_LOGGED_IN, "User not logged in!", "", 0, 0 },
+};
+
+// 32-bit FNV-1a started from the seed the generator found
+static uint32_t dispatch_hash(const char *name)
+{
+    uint32_t hash = 2166136261u ^ DISPATCH_SEED;
+
+    for (; *name; name++) {
+        hash ^= (unsigned char)*name;
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+const command *find_command(const char *name)
+{
+    const command *entry = &commands[dispatch_hash(name) & (DISPATCH_SIZE - 1)];
+
+    // Names that aren't commands land on an empty slot or on another command
+    if (!entry->name || strcmp(entry->name, name)) {
+        return NULL;
+    }
+
+    return entry;
+}
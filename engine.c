@@ -0,0 +1,194 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "engine.h"
+#include "parson.h"
+
+static void finish_job(engine_group *group)
+{
+    if (!group) {
+        return;
+    }
+
+    // The last task of a group wakes up whoever waits for it
+    pthread_mutex_lock(&group->lock);
+    if (--group->pending == 0) {
+        pthread_cond_broadcast(&group->done);
+    }
+    pthread_mutex_unlock(&group->lock);
+}
+
+static engine_job *pop_job(engine_job **head, engine_job **tail)
+{
+    engine_job *job = *head;
+    if (job) {
+        *head = job->next;
+        if (!*head) {
+            *tail = NULL;
+        }
+    }
+
+    return job;
+}
+
+static void push_job(engine_job **head, engine_job **tail, engine_job *job)
+{
+    if (*tail) {
+        (*tail)->next = job;
+    } else {
+        *head = job;
+    }
+    *tail = job;
+}
+
+static engine_job *new_job(engine_group *group, engine_task task, void *arg)
+{
+    engine_job *job = malloc(sizeof(engine_job));
+    if (!job) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    job->task = task;
+    job->arg = arg;
+    job->group = group;
+    job->next = NULL;
+
+    return job;
+}
+
+static void *worker(void *arg)
+{
+    task_engine *engine = arg;
+
+    while (1) {
+        pthread_mutex_lock(&engine->lock);
+        while (!engine->head && !engine->background_head && !engine->stopping) {
+            pthread_cond_wait(&engine->ready, &engine->lock);
+        }
+
+        // The queues are drained before stopping, background tasks last
+        engine_job *job = engine->head ? pop_job(&engine->head, &engine->tail)
+                                       : pop_job(&engine->background_head, &engine->background_tail);
+        pthread_mutex_unlock(&engine->lock);
+        if (!job) {
+            break;
+        }
+
+        job->task(job->arg);
+        finish_job(job->group);
+        free(job);
+    }
+
+    // JSON nodes recycled by this thread would otherwise be lost with it
+    json_release_pooled_memory();
+    return NULL;
+}
+
+void engine_start(task_engine *engine, size_t thread_count)
+{
+    pthread_mutex_init(&engine->lock, NULL);
+    pthread_cond_init(&engine->ready, NULL);
+    engine->head = NULL;
+    engine->tail = NULL;
+    engine->background_head = NULL;
+    engine->background_tail = NULL;
+    engine->stopping = 0;
+    engine->thread_count = 0;
+    engine->threads = NULL;
+
+    if (thread_count == 0) {
+        return;
+    }
+
+    engine->threads = calloc(thread_count, sizeof(pthread_t));
+    if (!engine->threads) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    // Fewer workers than asked for still work, tasks just wait longer
+    for (size_t i = 0; i < thread_count; i++) {
+        if (pthread_create(&engine->threads[engine->thread_count], NULL, worker, engine) == 0) {
+            engine->thread_count++;
+        }
+    }
+}
+
+void engine_stop(task_engine *engine)
+{
+    pthread_mutex_lock(&engine->lock);
+    engine->stopping = 1;
+    pthread_cond_broadcast(&engine->ready);
+    pthread_mutex_unlock(&engine->lock);
+
+    for (size_t i = 0; i < engine->thread_count; i++) {
+        pthread_join(engine->threads[i], NULL);
+    }
+
+    free(engine->threads);
+    engine->threads = NULL;
+    engine->thread_count = 0;
+    pthread_cond_destroy(&engine->ready);
+    pthread_mutex_destroy(&engine->lock);
+}
+
+void engine_submit(task_engine *engine, engine_group *group, engine_task task, void *arg)
+{
+    if (group) {
+        pthread_mutex_lock(&group->lock);
+        group->pending++;
+        pthread_mutex_unlock(&group->lock);
+    }
+
+    // Without workers the submitter does the work itself
+    if (engine->thread_count == 0) {
+        task(arg);
+        finish_job(group);
+        return;
+    }
+
+    engine_job *job = new_job(group, task, arg);
+
+    pthread_mutex_lock(&engine->lock);
+    push_job(&engine->head, &engine->tail, job);
+    pthread_cond_signal(&engine->ready);
+    pthread_mutex_unlock(&engine->lock);
+}
+
+int engine_submit_background(task_engine *engine, engine_task task, void *arg)
+{
+    // Running it inline would make the submitter wait for it
+    if (engine->thread_count == 0) {
+        return -1;
+    }
+
+    engine_job *job = new_job(NULL, task, arg);
+
+    pthread_mutex_lock(&engine->lock);
+    push_job(&engine->background_head, &engine->background_tail, job);
+    pthread_cond_signal(&engine->ready);
+    pthread_mutex_unlock(&engine->lock);
+    return 0;
+}
+
+void engine_group_init(engine_group *group)
+{
+    pthread_mutex_init(&group->lock, NULL);
+    pthread_cond_init(&group->done, NULL);
+    group->pending = 0;
+}
+
+void engine_group_wait(engine_group *group)
+{
+    pthread_mutex_lock(&group->lock);
+    while (group->pending > 0) {
+        pthread_cond_wait(&group->done, &group->lock);
+    }
+    pthread_mutex_unlock(&group->lock);
+}
+
+void engine_group_destroy(engine_group *group)
+{
+    pthread_cond_destroy(&group->done);
+    pthread_mutex_destroy(&group->lock);
+}
@@ -0,0 +1,59 @@
+#ifndef ENGINE_H_
+#define ENGINE_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+// Work run by the engine threads
+typedef void (*engine_task)(void *arg);
+
+// Tasks submitted together, so their submitter can wait for all of them
+typedef struct {
+    pthread_mutex_t lock;  // guards pending
+    pthread_cond_t done;   // signaled when pending drops to 0
+    size_t pending;        // tasks submitted but not finished yet
+} engine_group;
+
+// One queued task
+typedef struct engine_job {
+    engine_task task;
+    void *arg;
+    engine_group *group;     // NULL for a task nobody waits for
+    struct engine_job *next; // next task in the queue
+} engine_job;
+
+// Fixed set of worker threads running queued tasks in order; background tasks
+// only run when no other task is waiting
+typedef struct {
+    pthread_mutex_t lock;  // guards the queues and stopping
+    pthread_cond_t ready;  // signaled when a task is queued or the engine stops
+    engine_job *head;      // next task to run
+    engine_job *tail;      // last task queued
+    engine_job *background_head; // next background task to run
+    engine_job *background_tail; // last background task queued
+    pthread_t *threads;    // worker threads
+    size_t thread_count;   // 0 runs every task in the submitting thread
+    int stopping;          // set when the workers have to exit
+} task_engine;
+
+// starts thread_count worker threads; with 0 the tasks run when they are submitted
+void engine_start(task_engine *engine, size_t thread_count);
+
+// runs the tasks still queued, then stops and joins the workers
+void engine_stop(task_engine *engine);
+
+// queues a task, counting it in group if group is not NULL
+void engine_submit(task_engine *engine, engine_group *group, engine_task task, void *arg);
+
+// queues a task run only by otherwise idle workers; returns -1 (and runs nothing)
+// if the engine has no worker threads
+int engine_submit_background(task_engine *engine, engine_task task, void *arg);
+
+void engine_group_init(engine_group *group);
+
+// waits until every task submitted in the group has finished
+void engine_group_wait(engine_group *group);
+
+void engine_group_destroy(engine_group *group);
+
+#endif
@@ -0,0 +1,127 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "flight.h"
+
+void flight_init(flight_group *group)
+{
+    pthread_mutex_init(&group->lock, NULL);
+    group->calls = NULL;
+    group->shared = 0;
+}
+
+void flight_destroy(flight_group *group)
+{
+    pthread_mutex_destroy(&group->lock);
+}
+
+static flight_call *find_call(flight_group *group, const char *key)
+{
+    for (flight_call *call = group->calls; call; call = call->next) {
+        if (!strcmp(call->key, key)) {
+            return call;
+        }
+    }
+
+    return NULL;
+}
+
+static void unlink_call(flight_group *group, flight_call *call)
+{
+    flight_call **link = &group->calls;
+    while (*link != call) {
+        link = &(*link)->next;
+    }
+    *link = call->next;
+}
+
+static void free_call(flight_call *call)
+{
+    pthread_cond_destroy(&call->done);
+    free(call->key);
+    free(call);
+}
+
+static flight_result *make_result(char *response)
+{
+    flight_result *result = calloc(1, sizeof(flight_result));
+    if (!result) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    // Parse once, every caller reads the same split response
+    result->response = response;
+    result->valid = response && http_parse_response(response, &result->parsed) == 0;
+    return result;
+}
+
+flight_result *flight_do(flight_group *group, const char *key, flight_fn fn, void *arg)
+{
+    pthread_mutex_lock(&group->lock);
+
+    // Someone is already sending this request, wait for its answer
+    flight_call *call = find_call(group, key);
+    if (call) {
+        call->waiters++;
+        group->shared++;
+        while (!call->result) {
+            pthread_cond_wait(&call->done, &group->lock);
+        }
+
+        // The reference was taken for us, the last waiter frees the call
+        flight_result *result = call->result;
+        if (--call->waiters == 0) {
+            free_call(call);
+        }
+        pthread_mutex_unlock(&group->lock);
+        return result;
+    }
+
+    call = calloc(1, sizeof(flight_call));
+    char *key_copy = malloc(strlen(key) + 1);
+    if (!call || !key_copy) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    strcpy(key_copy, key);
+    call->key = key_copy;
+    pthread_cond_init(&call->done, NULL);
+    call->next = group->calls;
+    group->calls = call;
+    pthread_mutex_unlock(&group->lock);
+
+    // Send the request without holding the lock
+    flight_result *result = make_result(fn(arg));
+
+    // Later identical requests are sent again, only the waiters share this one
+    pthread_mutex_lock(&group->lock);
+    unlink_call(group, call);
+    result->refs = 1 + call->waiters;
+    call->result = result;
+    if (call->waiters > 0) {
+        pthread_cond_broadcast(&call->done);
+    } else {
+        free_call(call);
+    }
+    pthread_mutex_unlock(&group->lock);
+
+    return result;
+}
+
+void flight_release(flight_group *group, flight_result *result)
+{
+    if (!result) {
+        return;
+    }
+
+    pthread_mutex_lock(&group->lock);
+    size_t refs = --result->refs;
+    pthread_mutex_unlock(&group->lock);
+
+    if (refs == 0) {
+        free(result->response);
+        free(result);
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef FLIGHT_H_
+#define FLIGHT_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "http.h"
+
+// A response shared by every caller that asked for it while it was in flight
+typedef struct {
+    size_t refs;           // callers still using it, guarded by the group lock
+    char *response;        // raw response, NULL if the request failed
+    http_response parsed;  // the response split into status, headers and body
+    int valid;             // set when parsed could be filled in
+} flight_result;
+
+// A request being sent, which later identical requests wait for
+typedef struct flight_call {
+    char *key;                 // what identifies the request
+    flight_result *result;     // set once the request finished
+    size_t waiters;            // callers waiting besides the one sending it
+    pthread_cond_t done;       // signaled when result is set
+    struct flight_call *next;  // next request in flight
+} flight_call;
+
+// Requests in flight, so identical ones are sent only once
+typedef struct {
+    pthread_mutex_t lock;  // guards everything below and the result reference counts
+    flight_call *calls;    // requests in flight
+    size_t shared;         // requests answered by another caller's response
+} flight_group;
+
+// Sends the request identified by key; returns a malloc'd raw response, or NULL
+typedef char *(*flight_fn)(void *arg);
+
+void flight_init(flight_group *group);
+
+// call when nothing is in flight anymore
+void flight_destroy(flight_group *group);
+
+// runs fn(arg) unless an identical request (same key) is already in flight, in which case
+// its result is waited for and shared; release the result with flight_release
+flight_result *flight_do(flight_group *group, const char *key, flight_fn fn, void *arg);
+
+// drops one reference to a result, freeing it with the last one
+void flight_release(flight_group *group, flight_result *result);
+
+#endif
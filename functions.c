@@ -26,6 +26,11 @@ char *duplicate(const char *src) {
 
 int is_number(const char *str)
 {
+    // An empty value is no number, it would address the whole collection (e.g. /books/)
+    if (*str == '\0') {
+        return 0;
+    }
+
     // Iterate through each character in the string
     while (*str) {
         // Check if the current character is not a digit
@@ -70,17 +75,14 @@ char* serialize_json_to_string(JSON_Value *value) {
     return json_serialize_to_string_pretty(value);
 }
 
-void register_user(int sockfd)
+void register_user(server_conn *conn)
 {
     char user[NMAX], passwd[NMAX];
 
-    // Prompt the user for their username
-    printf("username=");
-    scanf("%s", user);
-
-    // Prompt the user for their password
-    printf("password=");
-    scanf("%s", passwd);
+    // Prompt the user for their username and password
+    if (prompt_for_credentials(user, passwd) < 0) {
+        return;
+    }
 
     // Generate a JSON string containing the user information
     char *info = generate_user_info(user, passwd);
@@ -91,34 +93,34 @@ void register_user(int sockfd)
     json_free_serialized_string(info);
 
     // Send the POST request to the server
-    send_to_server(sockfd, message);
+    send_to_server(conn_fd(conn), message);
     // Free the message string allocated by compute_post_request
     free(message);
 
     // Receive the server's response
-    char *response = receive_from_server(sockfd);
+    char *response = conn_receive(conn);
     // Tokenize the response to get the first line (usually the status line)
     char *token = strtok(response, "\n");
 
     // Print the first line of the server's response
-    printf("%s\n", token);
+    out_line(token);
 
     // Free the response string allocated by receive_from_server
     free(response);
 }
 
-char *send_login_request(int sockfd, char *info) {
+char *send_login_request(server_conn *conn, char *info) {
     // Create a POST request message with the login info JSON string
     char *message = compute_post_request((char *)IP, (char *)LOGIN_PATH, (char *)CONTENT_TYPE, &info, 1, NULL, 0, 0);
 
     // Send the POST request to the server
-    send_to_server(sockfd, message);
+    send_to_server(conn_fd(conn), message);
 
     // Free the message string allocated by compute_post_request
     free(message);
 
     // Receive and return the server's response
-    return receive_from_server(sockfd);
+    return conn_receive(conn);
 }
 
 void handle_login_response(const char *response, char **output, int *is_successful) {
@@ -127,7 +129,7 @@ void handle_login_response(const char *response, char **output, int *is_successf
 
     // Extract the first line from the response and print it
     char *line_one = strtok(response_copy, "\n");
-    printf("%s\n", line_one);
+    out_line(line_one);
     free(response_copy); // Free the duplicated response
 
     // Search for the "connect" string in the response
@@ -140,19 +142,14 @@ void handle_login_response(const char *response, char **output, int *is_successf
         if (json_start != NULL && json_end != NULL) {
             json_end[1] = '\0'; // Null-terminate the JSON string
 
-            // Duplicate the JSON part of the response
-            char *error_json = duplicate(json_start);
-            // Parse the JSON string
-            JSON_Value *parsed_json = json_parse_string(error_json);
-            // Get the JSON object from the parsed JSON value
-            JSON_Object *json_object = json_value_get_object(parsed_json);
+            // Index the JSON object lazily, only the "error" field gets decoded
+            JSON_Lazy *parsed_json = json_lazy_parse_string(json_start);
 
             // Print the error message extracted from the JSON object
-            printf("Error: %s\n", json_object_get_string(json_object, "error"));
+            out_printf("Error: %s\n", json_lazy_object_get_string(parsed_json, "error"));
 
-            // Free the duplicated JSON string and the parsed JSON value
-            free(error_json);
-            json_value_free(parsed_json);
+            // Free the lazily parsed JSON
+            json_lazy_free(parsed_json);
         }
 
         // Set the success flag to 0 (indicating failure)
@@ -169,34 +166,35 @@ void handle_login_response(const char *response, char **output, int *is_successf
 }
 
 
-char* login(int sockfd, char *cookie) {
+char* login(server_conn *conn, char *cookie, char *user) {
     if (cookie) {
-        printf("User is already logged in!\n");
+        out_printf("User is already logged in!\n");
         return cookie;
     }
 
-    char user[NMAX];
     char passwd[NMAX];
 
     // Prompt for username and password
-    prompt_for_credentials(user, passwd);
+    if (prompt_for_credentials(user, passwd) < 0) {
+        return NULL;
+    }
 
     // Process the login with the provided credentials
-    return process_login(sockfd, user, passwd);
+    return process_login(conn, user, passwd);
 }
 
-void prompt_for_credentials(char *user, char *passwd) {
-    // Prompt for username and password
-    printf("username=");
-    scanf("%s", user);
+int prompt_for_credentials(char *user, char *passwd) {
+    // Prompt for username and password, unless they followed the command
+    if (input_read("username=", user, NMAX) < 0) {
+        return -1;
+    }
 
-    printf("password=");
-    scanf("%s", passwd);
+    return input_read("password=", passwd, NMAX);
 }
 
-char* process_login(int sockfd, char *user, char *passwd) {
+char* process_login(server_conn *conn, char *user, char *passwd) {
     char *info = generate_user_info(user, passwd);
-    char *response = send_login_request(sockfd, info);
+    char *response = send_login_request(conn, info);
 
     // Free the JSON string allocated by generate_user_info
     json_free_serialized_string(info);
@@ -241,39 +239,54 @@ char *build_url(const char *base_path, const char *id_str) {
 
 
 // Main function for sending a GET request
-void send_get_request(int sockfd, char *url, char *token) {
-    // Create a GET request message with the provided URL and token
-    char *message = create_get_message(url, token);
+void send_get_request(server_conn *conn, char *url, char *token, book_cache *cache, book_catalog *catalog,
+                      int id, cache_entry *entry) {
+    // Create a GET request message with the provided URL and token, conditional if entry is set
+    char *message = create_get_message(url, token, entry);
 
     // Send the GET request to the server
-    transmit_message(sockfd, message);
+    transmit_message(conn, message);
 
     // Free the message string allocated by create_get_message
     free(message);
 
     // Receive the server's response
-    char *response = fetch_response(sockfd);
+    char *response = fetch_response(conn);
 
-    // Handle the received response
-    handle_get_response(response);
+    // Handle the received response, updating the cache
+    handle_cached_get_response(response, cache, catalog, id, entry);
 
     // Free the response string allocated by fetch_response
     free(response);
 }
 
-char* create_get_message(char *url, char *token) {
+char* create_get_message(char *url, char *token, cache_entry *entry) {
+    char if_none_match[ETAG_LEN + 16], if_modified_since[DATE_LEN + 32];
+    char *headers[2];
+    int headers_count = 0;
+
+    // Send the validators of a cached copy, so the server can answer 304 instead of the book
+    if (entry && entry->etag[0]) {
+        snprintf(if_none_match, sizeof(if_none_match), "If-None-Match: %s", entry->etag);
+        headers[headers_count++] = if_none_match;
+    }
+    if (entry && entry->last_modified[0]) {
+        snprintf(if_modified_since, sizeof(if_modified_since), "If-Modified-Since: %s", entry->last_modified);
+        headers[headers_count++] = if_modified_since;
+    }
+
     // create a GET request message
-    return compute_get_request((char *)IP, url, NULL, &token, 1, 1);
+    return compute_get_request_with_headers((char *)IP, url, NULL, &token, 1, 1, headers, headers_count);
 }
 
-void transmit_message(int sockfd, char *message) {
+void transmit_message(server_conn *conn, char *message) {
     // transmit the GET request message to the server
-    send_to_server(sockfd, message);
+    send_to_server(conn_fd(conn), message);
 }
 
-char* fetch_response(int sockfd) {
+char* fetch_response(server_conn *conn) {
     // fetch the server's response
-    return receive_from_server(sockfd);
+    return conn_receive(conn);
 }
 
 void handle_get_response(const char *response)
@@ -288,76 +301,242 @@ void handle_get_response(const char *response)
         // Null-terminate the JSON string
         stop[1] = '\0';
         // Print the JSON part of the response
-        printf("%s\n", start);
+        out_line(start);
     } else {
         // Print an error message if the response format is invalid
-        printf("Invalid response format\n");
+        out_printf("Invalid response format\n");
     }
 }
 
+void handle_cached_get_response(const char *response, book_cache *cache, book_catalog *catalog,
+                                int id, cache_entry *entry)
+{
+    http_response parsed;
+
+    // Split the response into status, headers and body
+    if (http_parse_response(response, &parsed) < 0) {
+        handle_get_response(response);
+        return;
+    }
+
+    // 304 Not Modified: the cached copy is still current
+    if (parsed.status == 304 && entry) {
+        cache_touch(entry);
+        catalog_touch_book(catalog, id);
+        out_line(entry->body);
+        return;
+    }
+
+    if (parsed.status == 200) {
+        // Remember the book together with its validators
+        char etag[ETAG_LEN] = "", last_modified[DATE_LEN] = "";
+        http_get_header(&parsed, "ETag", etag, sizeof(etag));
+        http_get_header(&parsed, "Last-Modified", last_modified, sizeof(last_modified));
+        cache_store(cache, id, parsed.body, parsed.body_len, etag, last_modified);
+        catalog_store_book(catalog, id, parsed.body, parsed.body_len, etag, last_modified);
+    } else if (entry) {
+        // The book is gone (or no longer ours), forget the old copy
+        cache_remove(cache, id);
+    }
+
+    // Deleted books are dropped from disk as well, and remembered as missing
+    if (parsed.status == 404) {
+        catalog_remove_book(catalog, id);
+        cache_store_missing(cache, id, parsed.body, parsed.body_len);
+    }
+
+    // Print the response the same way as an uncached lookup
+    handle_get_response(response);
+}
+
 int validate_token(char *token) {
     if (!token) {
-        printf("Cannot get the book - invalid or missing token\n");
+        out_printf("Cannot get the book - invalid or missing token\n");
         return 0;
     }
     return 1;
 }
 
-void prompt_for_id(char *id_str) {
-    printf("id=");
-    scanf("%s", id_str);
+int prompt_for_id(char *id_str) {
+    return input_read("id=", id_str, NMAX);
 }
 
-int check_id_is_number(char *id_str) {
-    if (is_number(id_str) == 0) {
-        printf("ID is not a number, please try again!\n");
+int check_id_is_number(const char *id_str, int *id) {
+    // Only digits, and no more than an int holds: a longer id would be cut down to a
+    // different one and hit that book's cache entries
+    char *end;
+    errno = 0;
+    long value = is_number(id_str) ? strtol(id_str, &end, 10) : 0;
+    if (value < 1 || value > INT_MAX || errno == ERANGE || *end != '\0') {
+        out_printf("ID is not a number, please try again!\n");
         return 0;
     }
+
+    *id = (int)value;
     return 1;
 }
 
-void process_book_request(int sockfd, char *id_str, char *token) {
+cache_entry *load_from_catalog(book_cache *cache, book_catalog *catalog, int id) {
+    // Only books whose details were stored can be served from disk
+    catalog_record record;
+    if (!catalog_find(catalog, id, &record) || !(record.flags & CATALOG_DETAILS)) {
+        return NULL;
+    }
+
+    // Copy the book into the memory cache, keeping the time it was last validated
+    cache_store(cache, id, record.body, record.body_len, record.etag, record.last_modified);
+    cache_entry *entry = cache_lookup(cache, id);
+    if (entry) {
+        entry->validated = (time_t)record.validated;
+    }
+
+    return entry;
+}
+
+const char *find_local_answer(book_cache *cache, book_catalog *catalog, int id, cache_entry **entry) {
+    // Look for the book in memory, then in the on-disk catalog left by earlier runs
+    *entry = cache_lookup(cache, id);
+    if (!*entry) {
+        *entry = load_from_catalog(cache, catalog, id);
+    }
+
+    // Ids known not to exist are answered by replaying the last 404
+    if (!*entry && cache->missing_body && cache_is_missing(cache, id)) {
+        return cache->missing_body;
+    }
+
+    // Serve the book locally while the cached copy is fresh
+    if (*entry && cache_is_fresh(cache, *entry)) {
+        return (*entry)->body;
+    }
+
+    // A stale copy without validators can't be revalidated, fetch the book again
+    if (*entry && !cache_has_validators(*entry)) {
+        cache_remove(cache, id);
+        *entry = NULL;
+    }
+
+    return NULL;
+}
+
+void process_book_request(server_conn *conn, char *id_str, int id, char *token, book_cache *cache, book_catalog *catalog) {
+    cache_entry *entry;
+
+    // Answer from the caches when they know enough
+    const char *local = find_local_answer(cache, catalog, id, &entry);
+    if (local) {
+        out_line(local);
+        return;
+    }
+
     char *url = build_url(GET_PATH, id_str);
-    send_get_request(sockfd, url, token);
+    send_get_request(conn, url, token, cache, catalog, id, entry);
     free(url);
 }
 
-void get_book(int sockfd, char *token) {
+void get_book(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog,
+              const bulk_sender *sender) {
     if (!validate_token(token)) {
         return;
     }
 
-    char id_str[NMAX];
-    prompt_for_id(id_str);
+    // The ids can follow the command, otherwise they are asked for
+    char ids[NMAX];
+    if (prompt_for_id(ids) < 0) {
+        return;
+    }
 
-    if (!check_id_is_number(id_str)) {
+    // Several ids or ranges are fetched in parallel
+    if (ids[0] != '\0' && !is_number(ids) && strspn(ids, "0123456789,- ") == strlen(ids)) {
+        get_many_books(ids, token, cache, catalog, sender);
         return;
     }
 
-    process_book_request(sockfd, id_str, token);
+    int id;
+    if (!check_id_is_number(ids, &id)) {
+        return;
+    }
+
+    process_book_request(conn, ids, id, token, cache, catalog);
 }
 
-char *build_get_books_request(char *token)
+char *build_get_books_request(char *token, const char *etag)
 {
+    char if_none_match[ETAG_LEN + 16];
+    char *headers[] = { if_none_match };
+
+    // Ask for the listing only if it changed since the stored copy
+    if (etag) {
+        snprintf(if_none_match, sizeof(if_none_match), "If-None-Match: %s", etag);
+    }
+
     // Create a GET request message with the provided token
-    return compute_get_request((char *)IP, GET_PATH, NULL, &token, 1, 1);
+    return compute_get_request_with_headers((char *)IP, GET_PATH, NULL, &token, 1, 1, headers, etag ? 1 : 0);
 }
 
-void send_request(int sockfd, char *message)
+void send_request(server_conn *conn, char *message, char *token, book_cache *cache, book_catalog *catalog,
+                  book_prefetcher *prefetcher)
 {
     // Send the request message to the server
-    send_to_server(sockfd, message);
+    send_to_server(conn_fd(conn), message);
 
     // Receive the server's response
-    char *response = receive_from_server(sockfd);
+    char *response = conn_receive(conn);
 
-    // Handle the received response
-    handle_books_response(response);
+    // Handle the received response, keeping the listing on disk
+    handle_cached_books_response(response, token, cache, catalog, prefetcher);
 
     // Free the response string allocated by receive_from_server
     free(response);
 }
 
+void print_stored_listing(char *token, book_cache *cache, book_catalog *catalog, book_prefetcher *prefetcher)
+{
+    // Rebuild the listing from the catalog records and print it
+    char *listing = catalog_build_listing(catalog);
+    out_line(listing);
+
+    // The ids in it are all the books there were when it was validated
+    cache_set_listing(cache, listing, catalog_listing_validated(catalog));
+    // Fetch the listed books not stored yet before they are asked for
+    prefetch_listing(prefetcher, listing, token, cache, catalog);
+    json_free_serialized_string(listing);
+}
+
+void handle_cached_books_response(const char *response, char *token, book_cache *cache, book_catalog *catalog,
+                                  book_prefetcher *prefetcher)
+{
+    http_response parsed;
+
+    // Split the response into status, headers and body
+    if (http_parse_response(response, &parsed) < 0) {
+        handle_books_response(response);
+        return;
+    }
+
+    // 304 Not Modified: the stored listing is still current
+    char stored_etag[ETAG_LEN];
+    if (parsed.status == 304 && catalog_listing_etag(catalog, stored_etag, sizeof(stored_etag))) {
+        catalog_touch_listing(catalog);
+        print_stored_listing(token, cache, catalog, prefetcher);
+        return;
+    }
+
+    // Keep a successful listing, along with its ETag
+    if (parsed.status == 200) {
+        char etag[ETAG_LEN] = "";
+        http_get_header(&parsed, "ETag", etag, sizeof(etag));
+        catalog_store_listing(catalog, parsed.body, parsed.body_len, etag);
+        // Remember which ids exist, so lookups of other ids need no request
+        cache_set_listing(cache, parsed.body, time(NULL));
+        // Fetch the listed books not stored yet before they are asked for
+        prefetch_listing(prefetcher, parsed.body, token, cache, catalog);
+    }
+
+    // Print the response the same way as without a catalog
+    handle_books_response(response);
+}
+
 void handle_books_response(const char *response)
 {
     // Find the start of the JSON array in the response
@@ -370,26 +549,34 @@ void handle_books_response(const char *response)
         // Null-terminate the JSON array string
         end[1] = '\0';
         // Print the JSON array part of the response
-        printf("%s\n", start);
+        out_line(start);
     } else {
         // Print an error message if the response format is invalid
-        printf("Invalid response format\n");
+        out_printf("Invalid response format\n");
     }
 }
 
-void get_books(int sockfd, char *token)
+void get_books(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog, book_prefetcher *prefetcher)
 {
     // Check if the token is valid
     if (!token) {
-        printf("Cannot get the list of books - invalid or missing token\n");
+        out_printf("Cannot get the list of books - invalid or missing token\n");
         return; // Return if the token is invalid or missing
     }
 
+    // Answer from disk while the stored listing is fresh
+    if (catalog_listing_is_fresh(catalog)) {
+        print_stored_listing(token, cache, catalog, prefetcher);
+        return;
+    }
+
     // Build the GET request message using the provided token
-    char *message = build_get_books_request(token);
+    char etag[ETAG_LEN];
+    int has_etag = catalog_listing_etag(catalog, etag, sizeof(etag));
+    char *message = build_get_books_request(token, has_etag ? etag : NULL);
 
     // Send the request to the server and handle the response
-    send_request(sockfd, message);
+    send_request(conn, message, token, cache, catalog, prefetcher);
 
     // Free the message string allocated by build_get_books_request
     free(message);
@@ -401,10 +588,10 @@ char *build_enter_library_request(char *cookie)
     return compute_get_request((char *)IP, ENTER_LIBRARY_PATH, NULL, &cookie, 1, 0);
 }
 
-void send_enter_library_request(int sockfd, char *message)
+void send_enter_library_request(server_conn *conn, char *message)
 {
     // Send the request message to the server
-    send_to_server(sockfd, message);
+    send_to_server(conn_fd(conn), message);
 }
 
 char *parse_enter_library_response(const char *response)
@@ -413,7 +600,7 @@ char *parse_enter_library_response(const char *response)
     char *copy = duplicate(response);
     // Extract and print the first line from the response
     char *tk = strtok(copy, "\n");
-    printf("%s\n", tk);
+    out_line(tk);
     // Free the duplicated response
     free(copy);
 
@@ -426,43 +613,38 @@ char *parse_enter_library_response(const char *response)
     if (start && stop) {
         // Null-terminate the JSON string
         stop[1] = '\0';
-        // Create a duplicate of the JSON string
-        char *json_string = duplicate(start);
 
-        // Parse the JSON string
-        JSON_Value *result = json_parse_string(json_string);
-        // Get the JSON object from the parsed JSON value
-        JSON_Object *obj = json_value_get_object(result);
+        // Index the JSON object lazily, only the "token" field gets decoded
+        JSON_Lazy *result = json_lazy_parse_string(start);
 
         // Extract the "token" field from the JSON object
-        char *token = duplicate(json_object_get_string(obj, "token"));
+        char *token = duplicate(json_lazy_object_get_string(result, "token"));
 
-        // Free the parsed JSON value and the duplicated JSON string
-        json_value_free(result);
-        free(json_string);
+        // Free the lazily parsed JSON
+        json_lazy_free(result);
 
         // Return the extracted token
         return token;
     } else {
         // Print an error message if the response format is invalid
-        printf("Invalid response format\n");
+        out_printf("Invalid response format\n");
         return NULL; // Return NULL to indicate failure
     }
 }
 
-char *enter_library(int sockfd, char *cookie)
+char *enter_library(server_conn *conn, char *cookie)
 {
     // Build the enter library request message
     char *message = build_enter_library_request(cookie);
 
     // Send the enter library request to the server
-    send_enter_library_request(sockfd, message);
+    send_enter_library_request(conn, message);
 
     // Free the message string allocated by build_enter_library_request
     free(message);
 
     // Receive the server's response
-    char *response = receive_from_server(sockfd);
+    char *response = conn_receive(conn);
 
     // Parse the response to extract the access token
     char *token = parse_enter_library_response(response);
@@ -474,7 +656,48 @@ char *enter_library(int sockfd, char *cookie)
     return token;
 }
 
-void read_book_info(JSON_Object *obj)
+char *start_session(server_conn *conn, char *user, char **token)
+{
+    char passwd[NMAX];
+
+    // Prompt for username and password, unless they followed the command
+    if (prompt_for_credentials(user, passwd) < 0) {
+        return NULL;
+    }
+
+    // Log in on the command's connection and keep it open
+    char *info = generate_user_info(user, passwd);
+    char *message = compute_post_request((char *)IP, (char *)LOGIN_PATH, (char *)CONTENT_TYPE, &info, 1, NULL, 0, 0);
+    json_free_serialized_string(info);
+    char *response = conn_request(conn, message);
+    free(message);
+
+    char *cookie = NULL;
+    int success = 0;
+    handle_login_response(response, &cookie, &success);
+    free(response);
+    if (!success) {
+        return NULL;
+    }
+
+    // Enter the library over the same connection, right away
+    *token = renew_library_access(conn, cookie);
+    return cookie;
+}
+
+char *renew_library_access(server_conn *conn, char *cookie)
+{
+    char *message = build_enter_library_request(cookie);
+    char *response = conn_request(conn, message);
+    free(message);
+
+    // Prints the status line and extracts the token
+    char *token = parse_enter_library_response(response);
+    free(response);
+    return token;
+}
+
+int read_book_info(JSON_Object *obj)
 {
     char buff[NMAX];
     // Fields and prompts for book information
@@ -484,19 +707,17 @@ void read_book_info(JSON_Object *obj)
 
     // Loop through each field to get input from the user
     for (int i = 0; i < num_fields; i++) {
-        // Prompt the user for the current field
-        printf("%s", prompts[i]);
-        // Read user input into buff
-        fgets(buff, NMAX, stdin);
-        // Remove the newline character if present
-        if (buff[strlen(buff) - 1] == '\n')
-            buff[strlen(buff) - 1] = '\0';
+        // Prompt the user for the current field, unless it followed the command
+        if (input_read(prompts[i], buff, NMAX) < 0) {
+            return -1;
+        }
 
         // If the current field is "page_count", validate and set it as a number
         if (strcmp(fields[i], "page_count") == 0) {
-            if (is_number(buff) == 0) {
-                printf("Invalid number of pages! Aborting request.\n");
-                exit(1);
+            if (buff[0] == '\0' || is_number(buff) == 0) {
+                // Only this request is dropped, the client keeps running
+                out_printf("Invalid number of pages! Aborting request.\n");
+                return -1;
             }
             // Convert the input to an integer and set it in the JSON object
             json_object_set_number(obj, fields[i], (double)atoi(buff));
@@ -505,6 +726,8 @@ void read_book_info(JSON_Object *obj)
             json_object_set_string(obj, fields[i], buff);
         }
     }
+
+    return 0;
 }
 
 char *build_add_book_request(JSON_Value *val, char *token)
@@ -537,13 +760,16 @@ char *build_add_book_request(JSON_Value *val, char *token)
 }
 
 
-void send_add_book_request(int sockfd, char *message)
+void send_add_book_request(server_conn *conn, char *message, JSON_Value *val, book_cache *cache, book_catalog *catalog)
 {
     // Send the request message to the server
-    send_to_server(sockfd, message);
+    send_to_server(conn_fd(conn), message);
 
     // Receive the server's response
-    char *response = receive_from_server(sockfd);
+    char *response = conn_receive(conn);
+
+    // Bring the cached listing up to date before the response gets tokenized
+    cache_added_book(response, val, cache, catalog);
 
     // Handle the received response
     handle_add_book_response(response);
@@ -556,23 +782,61 @@ void handle_add_book_response(char *response)
 {
     // Extract and print the first line from the response
     char *tk = strtok(response, "\n");
-    printf("%s\n", tk);
+    out_line(tk);
+}
+
+void cache_added_book(const char *response, JSON_Value *val, book_cache *cache, book_catalog *catalog)
+{
+    http_response parsed;
+
+    // A rejected book changes nothing
+    if (http_parse_response(response, &parsed) < 0 || parsed.status / 100 != 2) {
+        return;
+    }
+
+    // The server may answer with the created book, which tells us its id
+    JSON_Value *created = parsed.body_len ? json_parse_string(parsed.body) : NULL;
+    JSON_Object *book = json_value_get_object(created);
+    int id = (int)json_object_get_number(book, "id");
+
+    if (id > 0) {
+        // List the new book after the others, as the server does
+        catalog_listing_append(catalog, id, json_object_get_string(json_value_get_object(val), "title"));
+        cache_listing_add(cache, id);
+
+        // A full book in the body is exactly what get_book would return
+        if (json_object_has_value(book, "title")) {
+            cache_store(cache, id, parsed.body, parsed.body_len, NULL, NULL);
+            catalog_store_book(catalog, id, parsed.body, parsed.body_len, NULL, NULL);
+        }
+    } else {
+        // Without an id the new book can't be listed locally, ask the server next time
+        catalog_expire_listing(catalog);
+        cache_forget_listing(cache);
+    }
+
+    if (created) {
+        json_value_free(created);
+    }
 }
 
-void add_book(int sockfd, char *token)
+void add_book(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog)
 {
     // Initialize a new JSON object for the book information
     JSON_Value *val = json_value_init_object();
     JSON_Object *obj = json_value_get_object(val);
 
     // Read book information from the user and populate the JSON object
-    read_book_info(obj);
+    if (read_book_info(obj) < 0) {
+        json_value_free(val);
+        return;
+    }
 
     // Build the add book request message
     char *message = build_add_book_request(val, token);
 
     // Send the add book request to the server
-    send_add_book_request(sockfd, message);
+    send_add_book_request(conn, message, val, cache, catalog);
 
     // Free the message string allocated by build_add_book_request
     free(message);
@@ -610,13 +874,16 @@ char *build_delete_book_request(char *url, char *token)
     return compute_delete_request((char *)IP, url, NULL, &token, 1, 1);
 }
 
-void send_delete_book_request(int sockfd, char *message)
+void send_delete_book_request(server_conn *conn, char *message, int id, book_cache *cache, book_catalog *catalog)
 {
     // Send the request message to the server
-    send_to_server(sockfd, message);
+    send_to_server(conn_fd(conn), message);
 
     // Receive the server's response
-    char *response = receive_from_server(sockfd);
+    char *response = conn_receive(conn);
+
+    // Drop the book from the caches before the response gets tokenized
+    cache_deleted_book(response, id, cache, catalog);
 
     // Handle the received response
     handle_delete_book_response(response);
@@ -625,12 +892,24 @@ void send_delete_book_request(int sockfd, char *message)
     free(response);
 }
 
+void cache_deleted_book(const char *response, int id, book_cache *cache, book_catalog *catalog)
+{
+    // Both a successful delete and a 404 mean the book no longer exists
+    int status = http_status(response);
+    if (status / 100 == 2 || status == 404) {
+        cache_remove(cache, id);
+        cache_listing_remove(cache, id);
+        // The stored listing loses the book in place and stays usable
+        catalog_remove_book(catalog, id);
+    }
+}
+
 void handle_delete_book_response(char *response)
 {
     // Extract the first line from the response
     char *tk = strtok(response, "\n");
     // Print the first line of the response
-    printf("%s\n", tk);
+    out_line(tk);
 }
 
 /**
@@ -639,18 +918,19 @@ void handle_delete_book_response(char *response)
  * Parameters: the socket file descriptor, the cookie (to check if the user is
  * logged in) and the token (to check if the user accessed the library).
  */
-void delete_book(int sockfd, char *token)
+void delete_book(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog)
 {
     char id_str[NMAX];
 
     // Prompt the user for the book ID
-    printf("id=");
-    scanf("%s", id_str);
+    if (prompt_for_id(id_str) < 0) {
+        return;
+    }
 
-    // Check if the provided ID is a number
-    if (is_number(id_str) == 0) {
-        printf("ID is not a number, please try again!\n");
-        return; // Return if the ID is not a number
+    // Check if the provided ID is a number an int holds, a longer one would evict another book
+    int id;
+    if (!check_id_is_number(id_str, &id)) {
+        return;
     }
 
     // Build the URL for the delete book request using the provided ID
@@ -659,26 +939,213 @@ void delete_book(int sockfd, char *token)
     char *message = build_delete_book_request(url, token);
 
     // Send the delete book request to the server
-    send_delete_book_request(sockfd, message);
+    send_delete_book_request(conn, message, id, cache, catalog);
 
     // Free the URL and message strings allocated by build_delete_book_url and build_delete_book_request
     free(url);
     free(message);
 }
 
+void fetch_book_task(void *arg)
+{
+    book_fetch *fetch = arg;
+
+    // Runs on an engine thread: only the pooled connection is touched, never the caches
+    fetch->result = pool_request_shared(fetch->pool, fetch->message);
+}
+
+int book_is_stored(book_cache *cache, book_catalog *catalog, int id)
+{
+    // The catalog keeps everything that was fetched, the memory cache only the recent books
+    catalog_record record;
+    if (catalog_find(catalog, id, &record) && (record.flags & CATALOG_DETAILS)) {
+        return 1;
+    }
+
+    return cache_lookup(cache, id) != NULL;
+}
+
+size_t collect_new_books(const char *listing, size_t limit, book_cache *cache, book_catalog *catalog,
+                         int **ids)
+{
+    // Only the ids are needed, the tape reads them without building a tree
+    JSON_Tape *tape = json_tape_parse_string(listing);
+    const JSON_Tape_Value *books = json_tape_get_root(tape);
+    size_t count = json_tape_array_get_count(books);
+    if (count > limit) {
+        count = limit;
+    }
+    size_t new_count = 0;
+
+    *ids = malloc((count ? count : 1) * sizeof(int));
+    if (*ids == NULL) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    // Keep the first listed books whose details aren't stored locally yet
+    for (size_t i = 0; i < count; i++) {
+        double id = json_tape_object_get_number(json_tape_array_get_object(books, i), "id");
+        if (id > 0 && id < 0x7fffffff && !book_is_stored(cache, catalog, (int)id)) {
+            (*ids)[new_count++] = (int)id;
+        }
+    }
+
+    json_tape_free(tape);
+    return new_count;
+}
+
+int store_fetched_book(const flight_result *result, book_cache *cache, book_catalog *catalog, int id)
+{
+    // The response may be shared with other requests, it is only read
+    const http_response *parsed = &result->parsed;
+    if (!result->valid) {
+        return -1;
+    }
+
+    if (parsed->status == 200) {
+        // Remember the book together with its validators, as get_book does
+        char etag[ETAG_LEN] = "", last_modified[DATE_LEN] = "";
+        http_get_header(parsed, "ETag", etag, sizeof(etag));
+        http_get_header(parsed, "Last-Modified", last_modified, sizeof(last_modified));
+        cache_store(cache, id, parsed->body, parsed->body_len, etag, last_modified);
+        catalog_store_book(catalog, id, parsed->body, parsed->body_len, etag, last_modified);
+        return 0;
+    }
+
+    // Deleted between the listing and the fetch
+    if (parsed->status == 404) {
+        catalog_remove_book(catalog, id);
+        cache_store_missing(cache, id, parsed->body, parsed->body_len);
+        return 1;
+    }
+
+    return -1;
+}
+
+size_t fetch_new_books(char *token, const int *ids, size_t count, book_cache *cache,
+                       book_catalog *catalog, connection_pool *pool, task_engine *engine,
+                       size_t *removed)
+{
+    size_t failed = 0;
+    engine_group group;
+
+    book_fetch *fetches = calloc(count ? count : 1, sizeof(book_fetch));
+    if (fetches == NULL) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    // Queue every fetch at once, the engine threads share the pooled connections
+    engine_group_init(&group);
+    for (size_t i = 0; i < count; i++) {
+        char id_str[LEN];
+        snprintf(id_str, sizeof(id_str), "%d", ids[i]);
+        char *url = build_url(GET_PATH, id_str);
+
+        fetches[i].pool = pool;
+        fetches[i].message = create_get_message(url, token, NULL);
+        engine_submit(engine, &group, fetch_book_task, &fetches[i]);
+        free(url);
+    }
+    engine_group_wait(&group);
+    engine_group_destroy(&group);
+
+    // Store the books from this thread, in listing order
+    for (size_t i = 0; i < count; i++) {
+        int result = store_fetched_book(fetches[i].result, cache, catalog, ids[i]);
+        if (result < 0) {
+            failed++;
+        } else if (result > 0) {
+            (*removed)++;
+        }
+
+        free(fetches[i].message);
+        pool_release_result(pool, fetches[i].result);
+    }
+
+    free(fetches);
+    return failed;
+}
+
+void sync_books(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog,
+                connection_pool *pool, task_engine *engine)
+{
+    if (!token) {
+        out_printf("Cannot sync the library - invalid or missing token\n");
+        return;
+    }
+
+    // Ask for the id list, or only for confirmation if the stored one is still current
+    char etag[ETAG_LEN];
+    int has_etag = catalog_listing_etag(catalog, etag, sizeof(etag));
+    char *message = build_get_books_request(token, has_etag ? etag : NULL);
+    send_to_server(conn_fd(conn), message);
+    free(message);
+    char *response = conn_receive(conn);
+
+    http_response parsed;
+    char *stored = NULL;
+    const char *listing = NULL;
+    int forgotten = 0;
+
+    if (http_parse_response(response, &parsed) < 0) {
+        out_printf("Invalid response format\n");
+        free(response);
+        return;
+    }
+
+    if (parsed.status == 304 && has_etag) {
+        // Nothing was added or deleted, but earlier failed fetches are retried
+        catalog_touch_listing(catalog);
+        stored = catalog_build_listing(catalog);
+        listing = stored;
+    } else if (parsed.status == 200) {
+        // Books that left the listing are dropped from disk here
+        char etag[ETAG_LEN] = "";
+        http_get_header(&parsed, "ETag", etag, sizeof(etag));
+        forgotten = catalog_store_listing(catalog, parsed.body, parsed.body_len, etag);
+        listing = parsed.body;
+    } else {
+        // Print the error the server sent
+        char *tk = strtok(response, "\n");
+        out_line(tk);
+        free(response);
+        return;
+    }
+
+    // Evict the deleted books from memory as well
+    cache_set_listing(cache, listing, time(NULL));
+    size_t pruned = cache_prune_unlisted(cache);
+    size_t removed = forgotten > 0 ? (size_t)forgotten : pruned;
+
+    // Fetch only what isn't stored yet
+    int *ids;
+    size_t count = collect_new_books(listing, SIZE_MAX, cache, catalog, &ids);
+    size_t failed = fetch_new_books(token, ids, count, cache, catalog, pool, engine, &removed);
+
+    out_printf("Synced library: %zu fetched, %zu removed, %zu failed\n", count - failed, removed, failed);
+
+    free(ids);
+    if (stored) {
+        json_free_serialized_string(stored);
+    }
+    free(response);
+}
+
 char *build_logout_request(char *cookie)
 {
     // Create a GET request message with the provided cookie
     return compute_get_request((char *)IP, LOGOUT_PATH, NULL, &cookie, 1, 0);
 }
 
-void send_logout_request(int sockfd, char *message)
+void send_logout_request(server_conn *conn, char *message)
 {
     // Send the request message to the server
-    send_to_server(sockfd, message);
+    send_to_server(conn_fd(conn), message);
 
     // Receive the server's response
-    char *response = receive_from_server(sockfd);
+    char *response = conn_receive(conn);
 
     // Handle the received response
     handle_logout_response(response);
@@ -692,26 +1159,17 @@ void handle_logout_response(char *response)
     // Extract the first line from the response
     char *tk = strtok(response, "\n");
     // Print the first line of the response
-    printf("%s\n", tk);
+    out_line(tk);
 }
 
-void logout(int sockfd, char *cookie)
+void logout(server_conn *conn, char *cookie)
 {
     // Build the logout request message using the provided cookie
     char *message = build_logout_request(cookie);
 
     // Send the logout request to the server and handle the response
-    send_logout_request(sockfd, message);
+    send_logout_request(conn, message);
 
     // Free the message string allocated by build_logout_request
     free(message);
 }
-
-void exit_client(int sockfd)
-{
-    // Close the HTTP connection over TCP
-    close_connection(sockfd);
-
-    // Exit the program
-    exit(0);
-}
\ No newline at end of file
@@ -2,6 +2,9 @@
 #define FUNCTIONS_H_
 
 #include <stdio.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <string.h>
 #include <sys/socket.h>
@@ -13,6 +16,16 @@
 #include "helpers.h"
 #include "buffer.h"
 #include "parson.h"
+#include "http.h"
+#include "cache.h"
+#include "catalog.h"
+#include "pool.h"
+#include "engine.h"
+#include "prefetch.h"
+#include "bulk.h"
+#include "input.h"
+#include "out.h"
+#include "conn.h"
 
 
 #define NMAX 100
@@ -34,54 +47,91 @@ int is_number(const char *str);
 char* generate_user_info(char *user, char *password);
 void populate_user_json_object(JSON_Object *obj, char *user, char *password);
 char* serialize_json_to_string(JSON_Value *value);
-void register_user(int sockfd);
+void register_user(server_conn *conn);
 
-char *send_login_request(int sockfd, char *info);
+char *send_login_request(server_conn *conn, char *info);
 void handle_login_response(const char *response, char **to_ret, int *success);
-void prompt_for_credentials(char *user, char *passwd);
-char* process_login(int sockfd, char *user, char *passwd);
-char* login(int sockfd, char *cookie);
+int prompt_for_credentials(char *user, char *passwd);
+char* process_login(server_conn *conn, char *user, char *passwd);
+char* login(server_conn *conn, char *cookie, char *user);
 
 char *build_url(const char *base_path, const char *id_str);
-void send_get_request(int sockfd, char *url, char *token);
-char* create_get_message(char *url, char *token);
-void transmit_message(int sockfd, char *message);
-char* fetch_response(int sockfd);
+void send_get_request(server_conn *conn, char *url, char *token, book_cache *cache, book_catalog *catalog,
+                      int id, cache_entry *entry);
+char* create_get_message(char *url, char *token, cache_entry *entry);
+void transmit_message(server_conn *conn, char *message);
+char* fetch_response(server_conn *conn);
 void handle_get_response(const char *response);
-void get_book(int sockfd, char *token);
-
-char *build_get_books_request(char *token);
-void send_request(int sockfd, char *message);
+void handle_cached_get_response(const char *response, book_cache *cache, book_catalog *catalog,
+                                int id, cache_entry *entry);
+void get_book(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog,
+              const bulk_sender *sender);
+
+char *build_get_books_request(char *token, const char *etag);
+void send_request(server_conn *conn, char *message, char *token, book_cache *cache, book_catalog *catalog,
+                  book_prefetcher *prefetcher);
 void handle_books_response(const char *response);
+void print_stored_listing(char *token, book_cache *cache, book_catalog *catalog, book_prefetcher *prefetcher);
+void handle_cached_books_response(const char *response, char *token, book_cache *cache, book_catalog *catalog,
+                                  book_prefetcher *prefetcher);
 
 int validate_token(char *token);
-void prompt_for_id(char *id_str);
-int check_id_is_number(char *id_str);
-void process_book_request(int sockfd, char *id_str, char *token);
-void get_books(int sockfd, char *token);
+int prompt_for_id(char *id_str);
+// parses a book id into id, which must be in 1..INT_MAX so it can't wrap into another
+// book's id; prints why and returns 0 if it isn't
+int check_id_is_number(const char *id_str, int *id);
+cache_entry *load_from_catalog(book_cache *cache, book_catalog *catalog, int id);
+const char *find_local_answer(book_cache *cache, book_catalog *catalog, int id, cache_entry **entry);
+void process_book_request(server_conn *conn, char *id_str, int id, char *token, book_cache *cache, book_catalog *catalog);
+void get_books(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog, book_prefetcher *prefetcher);
 
 char *build_enter_library_request(char *cookie);
-void send_enter_library_request(int sockfd, char *message);
+void send_enter_library_request(server_conn *conn, char *message);
 char *parse_enter_library_response(const char *response);
-char *enter_library(int sockfd, char *cookie);
+char *enter_library(server_conn *conn, char *cookie);
+
+// logs in and enters the library over one kept-alive connection, without prompting in
+// between; returns the session cookie (NULL if the login failed) and sets *token
+char *start_session(server_conn *conn, char *user, char **token);
+// asks for a new library token with cookie over the command's connection; NULL if refused
+char *renew_library_access(server_conn *conn, char *cookie);
 
-void read_book_info(JSON_Object *obj);
+int read_book_info(JSON_Object *obj);
 char *build_add_book_request(JSON_Value *val, char *token);
-void send_add_book_request(int sockfd, char *message);
+void send_add_book_request(server_conn *conn, char *message, JSON_Value *val, book_cache *cache, book_catalog *catalog);
 void handle_add_book_response(char *response);
-void add_book(int sockfd, char *token);
+void cache_added_book(const char *response, JSON_Value *val, book_cache *cache, book_catalog *catalog);
+void add_book(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog);
 
 char *build_delete_book_url(const char *id_str);
 char *build_delete_book_request(char *url, char *token);
-void send_delete_book_request(int sockfd, char *message);
+void send_delete_book_request(server_conn *conn, char *message, int id, book_cache *cache, book_catalog *catalog);
+void cache_deleted_book(const char *response, int id, book_cache *cache, book_catalog *catalog);
 void handle_delete_book_response(char *response);
-void delete_book(int sockfd, char *token);
+void delete_book(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog);
+
+// One get_book request run by an engine thread during sync
+typedef struct {
+    connection_pool *pool; // where the request is sent
+    char *message;         // the request
+    flight_result *result; // the response, shared with identical requests in flight
+} book_fetch;
+
+void fetch_book_task(void *arg);
+int book_is_stored(book_cache *cache, book_catalog *catalog, int id);
+size_t collect_new_books(const char *listing, size_t limit, book_cache *cache, book_catalog *catalog,
+                         int **ids);
+int store_fetched_book(const flight_result *result, book_cache *cache, book_catalog *catalog, int id);
+size_t fetch_new_books(char *token, const int *ids, size_t count, book_cache *cache,
+                       book_catalog *catalog, connection_pool *pool, task_engine *engine,
+                       size_t *removed);
+void sync_books(server_conn *conn, char *token, book_cache *cache, book_catalog *catalog,
+                connection_pool *pool, task_engine *engine);
 
 char *build_logout_request(char *cookie);
-void send_logout_request(int sockfd, char *message);
+void send_logout_request(server_conn *conn, char *message);
 void handle_logout_response(char *response);
-void logout(int sockfd, char *cookie);
+void logout(server_conn *conn, char *cookie);
 
-void exit_client(int sockfd);
 
 #endif
\ No newline at end of file
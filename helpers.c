@@ -10,6 +10,7 @@
 #include <arpa/inet.h>
 #include "helpers.h"
 #include "buffer.h"
+#include "http.h"
 
 #define HEADER_TERMINATOR "\r\n\r\n"
 #define HEADER_TERMINATOR_SIZE (sizeof(HEADER_TERMINATOR) - 1)
@@ -72,61 +73,137 @@ void send_to_server(int sockfd, char *message)
     } while (sent < total);
 }
 
-char *receive_from_server(int sockfd)
+// reads one response into buffer (null-terminated); returns 0 when it is
+// complete, 1 if the connection was closed before that and -1 on a read error
+static int read_response(int sockfd, buffer *buffer)
 {
     char response[BUFLEN];
-    buffer buffer = buffer_init();
-    int header_end = 0;
+    int header_end = -1;
     int content_length = 0;
+    int status = 1;
 
     do {
         int bytes = read(sockfd, response, BUFLEN);
 
         if (bytes < 0){
-            error("ERROR reading response from socket");
+            return -1;
         }
 
         if (bytes == 0) {
+            // without a Content-Length the body ends when the connection does
+            if (header_end >= 0) {
+                status = 0;
+            }
             break;
         }
 
-        buffer_add(&buffer, response, (size_t) bytes);
+        buffer_add(buffer, response, (size_t) bytes);
         
-        header_end = buffer_find(&buffer, HEADER_TERMINATOR, HEADER_TERMINATOR_SIZE);
+        header_end = buffer_find(buffer, HEADER_TERMINATOR, HEADER_TERMINATOR_SIZE);
 
         if (header_end >= 0) {
             header_end += HEADER_TERMINATOR_SIZE;
             
-            int content_length_start = buffer_find_insensitive(&buffer, CONTENT_LENGTH, CONTENT_LENGTH_SIZE);
+            int content_length_start = buffer_find_insensitive(buffer, CONTENT_LENGTH, CONTENT_LENGTH_SIZE);
             
             if (content_length_start < 0) {
+                // 304 and friends have no body and no Content-Length, the headers are everything
+                if (http_status_has_no_body(http_status(buffer->data))) {
+                    status = 0;
+                    break;
+                }
                 continue;           
             }
 
             content_length_start += CONTENT_LENGTH_SIZE;
-            content_length = strtol(buffer.data + content_length_start, NULL, 10);
+            content_length = strtol(buffer->data + content_length_start, NULL, 10);
+            status = 0;
             break;
         }
     } while (1);
     size_t total = content_length + (size_t) header_end;
     
-    while (buffer.size < total) {
+    while (status == 0 && buffer->size < total) {
         int bytes = read(sockfd, response, BUFLEN);
 
         if (bytes < 0) {
-            error("ERROR reading response from socket");
+            return -1;
         }
 
         if (bytes == 0) {
+            status = 1;
             break;
         }
 
-        buffer_add(&buffer, response, (size_t) bytes);
+        buffer_add(buffer, response, (size_t) bytes);
+    }
+    buffer_add(buffer, "", 1);
+    return status;
+}
+
+char *receive_from_server(int sockfd)
+{
+    buffer buffer = buffer_init();
+
+    // whatever arrived before the server closed the connection is the response
+    if (read_response(sockfd, &buffer) < 0) {
+        error("ERROR reading response from socket");
+    }
+
+    return buffer.data;
+}
+
+int try_send_to_server(int sockfd, const char *message)
+{
+    size_t sent = 0;
+    size_t total = strlen(message);
+
+    while (sent < total) {
+        ssize_t bytes = write(sockfd, message + sent, total - sent);
+        if (bytes <= 0) {
+            return -1;
+        }
+
+        sent += (size_t) bytes;
+    }
+
+    return 0;
+}
+
+char *try_receive_from_server(int sockfd)
+{
+    buffer buffer = buffer_init();
+
+    // a reused connection the server already closed gives back an incomplete response
+    if (read_response(sockfd, &buffer) != 0) {
+        buffer_destroy(&buffer);
+        return NULL;
     }
-    buffer_add(&buffer, "", 1);
+
     return buffer.data;
 }
 
+int try_open_connection(char *host_ip, int portno, int ip_type, int socket_type, int flag)
+{
+    struct sockaddr_in serv_addr;
+    int sockfd = socket(ip_type, socket_type, flag);
+    if (sockfd < 0)
+        return -1;
+
+    memset(&serv_addr, 0, sizeof(serv_addr));
+    serv_addr.sin_family = ip_type;
+    serv_addr.sin_port = htons(portno);
+    inet_pton(ip_type, host_ip, &serv_addr.sin_addr);
+
+    /* connect the socket */
+    if (connect(sockfd, (struct sockaddr*) &serv_addr, sizeof(serv_addr)) < 0) {
+        close(sockfd);
+        return -1;
+    }
+
+    return sockfd;
+}
+
 char *basic_extract_json_response(char *str)
 {
     return strstr(str, "{\"");
@@ -24,6 +24,16 @@ void send_to_server(int sockfd, char *message);
 // receives and returns the message from a server
 char *receive_from_server(int sockfd);
 
+// opens a connection like open_connection, but returns -1 instead of exiting on failure
+int try_open_connection(char *host_ip, int portno, int ip_type, int socket_type, int flag);
+
+// sends a message like send_to_server, but returns -1 instead of exiting on failure
+int try_send_to_server(int sockfd, const char *message);
+
+// receives a message like receive_from_server, but returns NULL on a read error
+// or if the connection was closed before the whole response arrived
+char *try_receive_from_server(int sockfd);
+
 // extracts and returns a JSON from a server response
 char *basic_extract_json_response(char *str);
 
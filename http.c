@@ -0,0 +1,130 @@
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+
+#include "http.h"
+
+int http_status(const char *response)
+{
+    // The status line looks like "HTTP/1.1 200 OK"
+    if (response == NULL || strncmp(response, "HTTP/", 5) != 0) {
+        return -1;
+    }
+
+    // The code follows the first space; stay on the status line, the
+    // response may still be incomplete and not null-terminated yet
+    const char *code = response + 5;
+    while (*code != ' ' && *code != '\r' && *code != '\n' && *code != '\0') {
+        code++;
+    }
+    if (*code != ' ' || !isdigit((unsigned char)code[1])) {
+        return -1;
+    }
+
+    return (int)strtol(code + 1, NULL, 10);
+}
+
+int http_status_has_no_body(int status)
+{
+    // Informational, No Content and Not Modified responses end with their headers
+    return (status >= 100 && status < 200) || status == 204 || status == 304;
+}
+
+int http_parse_response(const char *response, http_response *parsed)
+{
+    // Read the status code from the status line
+    parsed->status = http_status(response);
+    if (parsed->status < 0) {
+        return -1;
+    }
+
+    // Headers start on the line after the status line
+    const char *headers = strstr(response, "\r\n");
+    // The blank line separates the headers from the body
+    const char *end = strstr(response, "\r\n\r\n");
+    if (headers == NULL || end == NULL) {
+        return -1;
+    }
+
+    parsed->headers = headers + 2;
+    parsed->headers_len = end > headers ? (size_t)(end - parsed->headers) : 0;
+
+    // Everything after the blank line is the body
+    parsed->body = end + 4;
+    parsed->body_len = strlen(parsed->body);
+    return 0;
+}
+
+int http_get_header(const http_response *parsed, const char *name, char *value, size_t value_size)
+{
+    size_t name_len = strlen(name);
+    const char *line = parsed->headers;
+    const char *end = parsed->headers + parsed->headers_len;
+
+    // Walk the header block line by line
+    while (line < end) {
+        const char *eol = strstr(line, "\r\n");
+        if (eol == NULL || eol > end) {
+            eol = end;
+        }
+
+        // Match "Name:" without regard to case
+        if ((size_t)(eol - line) > name_len && line[name_len] == ':' &&
+            strncasecmp(line, name, name_len) == 0) {
+            // Skip the separator and the leading spaces of the value
+            const char *start = line + name_len + 1;
+            while (start < eol && (*start == ' ' || *start == '\t')) {
+                start++;
+            }
+
+            // Copy as much of the value as fits
+            size_t len = (size_t)(eol - start);
+            if (len >= value_size) {
+                len = value_size - 1;
+            }
+            memcpy(value, start, len);
+            value[len] = '\0';
+            return 1;
+        }
+
+        line = eol + 2;
+    }
+
+    return 0;
+}
+
+int http_response_length(const char *data, size_t size, size_t *length)
+{
+    // Nothing can be said before the headers are complete
+    const char *end = strstr(data, "\r\n\r\n");
+    if (end == NULL || (size_t)(end - data) + 4 > size) {
+        return 0;
+    }
+
+    http_response head;
+    head.status = http_status(data);
+    head.headers = strstr(data, "\r\n") + 2;
+    head.headers_len = end > head.headers ? (size_t)(end - head.headers) : 0;
+    size_t headers_size = (size_t)(end - data) + 4;
+
+    // Bodiless responses end with their headers
+    if (http_status_has_no_body(head.status)) {
+        *length = headers_size;
+        return 1;
+    }
+
+    // Otherwise the body length has to be announced, or it runs until the connection closes
+    char value[32];
+    if (!http_get_header(&head, "Content-Length", value, sizeof(value))) {
+        return -1;
+    }
+
+    size_t body_len = (size_t)strtoul(value, NULL, 10);
+    if (size < headers_size + body_len) {
+        return 0;
+    }
+
+    *length = headers_size + body_len;
+    return 1;
+}
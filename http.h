@@ -0,0 +1,34 @@
+#ifndef HTTP_H_
+#define HTTP_H_
+
+#include <stddef.h>
+
+// A server response split into its parts. The pointers refer to the raw
+// response returned by receive_from_server, which is not modified.
+typedef struct {
+    int status;          // status code from the status line (e.g. 200, 304, 404)
+    const char *headers; // first header line, right after the status line
+    size_t headers_len;  // length of the header block, without the blank line
+    const char *body;    // payload, empty for responses without one
+    size_t body_len;     // length of the payload
+} http_response;
+
+// returns the status code of a raw response, or -1 if there is no status line
+int http_status(const char *response);
+
+// checks if a response with this status code never carries a body (1xx, 204, 304)
+int http_status_has_no_body(int status);
+
+// splits a raw response into status, headers and body; returns 0 on success, -1 if malformed
+int http_parse_response(const char *response, http_response *parsed);
+
+// looks at the start of data (null-terminated, size bytes) for a whole response; returns 1 and
+// sets length if it is complete, 0 if more data is needed and -1 if the body lasts until the
+// connection is closed. Used to split responses that arrive back to back on one connection
+int http_response_length(const char *data, size_t size, size_t *length);
+
+// copies the value of the header called name (case-insensitive) into value,
+// returns 1 if the header was found and 0 otherwise
+int http_get_header(const http_response *parsed, const char *name, char *value, size_t value_size);
+
+#endif
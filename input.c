@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+
+#include "input.h"
+#include "out.h"
+
+// Arguments of the command being run, and whether prompts are allowed
+static char **pending_args;
+static int pending_count;
+static int batch_mode;
+
+void input_set_batch(int batch)
+{
+    batch_mode = batch;
+}
+
+void input_set_args(char **args, int count)
+{
+    pending_args = args;
+    pending_count = count;
+}
+
+int input_read(const char *prompt, char *value, size_t size)
+{
+    // Arguments given on the command line answer the prompts in order
+    if (pending_count > 0) {
+        snprintf(value, size, "%s", *pending_args);
+        pending_args++;
+        pending_count--;
+        return 0;
+    }
+
+    // A batch has nobody to ask
+    if (batch_mode) {
+        out_printf("Missing %.*s\n", (int)strcspn(prompt, "="), prompt);
+        return -1;
+    }
+
+    // The prompt and everything printed before it must be seen before reading
+    out_printf("%s", prompt);
+    out_flush();
+    if (!fgets(value, (int)size, stdin)) {
+        return -1;
+    }
+
+    // Drop the newline, or the rest of a line too long to keep
+    size_t len = strcspn(value, "\n");
+    if (value[len] != '\n' && !feof(stdin)) {
+        int c;
+        while ((c = getchar()) != '\n' && c != EOF) {
+        }
+    }
+    value[len] = '\0';
+    if (len > 0 && value[len - 1] == '\r') {
+        value[len - 1] = '\0';
+    }
+
+    return 0;
+}
+
+int split_command_line(char *line, char **words, int max)
+{
+    char *in = line, *out = line;
+    int count = 0;
+
+    while (count < max) {
+        while (isspace((unsigned char)*in)) {
+            in++;
+        }
+        if (*in == '\0') {
+            break;
+        }
+
+        // Copy the word over itself, dropping quotes and escapes
+        words[count++] = out;
+        char quote = 0;
+        while (*in != '\0' && (quote || !isspace((unsigned char)*in))) {
+            if (!quote && (*in == '"' || *in == '\'')) {
+                quote = *in++;
+            } else if (quote && *in == quote) {
+                quote = 0;
+                in++;
+            } else if (*in == '\\' && quote != '\'' && in[1] != '\0') {
+                in++;
+                *out++ = *in++;
+            } else {
+                *out++ = *in++;
+            }
+        }
+
+        // The terminator never lands past the character just read
+        int more = *in != '\0';
+        *out++ = '\0';
+        if (!more) {
+            break;
+        }
+        in++;
+    }
+
+    return count;
+}
+
+int line_reader_init(line_reader *reader, int fd)
+{
+    reader->fd = fd;
+    reader->start = 0;
+    reader->size = 0;
+    reader->capacity = READER_CHUNK;
+    reader->eof = 0;
+    reader->data = malloc(reader->capacity);
+
+    return reader->data ? 0 : -1;
+}
+
+char *line_reader_next(line_reader *reader)
+{
+    while (1) {
+        // A whole line is waiting: terminate it where it is
+        char *line = reader->data + reader->start;
+        char *newline = memchr(line, '\n', reader->size - reader->start);
+        if (newline) {
+            *newline = '\0';
+            reader->start = (size_t)(newline - reader->data) + 1;
+            if (newline > line && newline[-1] == '\r') {
+                newline[-1] = '\0';
+            }
+            return line;
+        }
+
+        // The last line may have no newline
+        if (reader->eof) {
+            if (reader->start == reader->size) {
+                return NULL;
+            }
+            reader->data[reader->size] = '\0';
+            reader->start = reader->size;
+            return line;
+        }
+
+        // Move the partial line to the front, growing the buffer only for very long lines
+        memmove(reader->data, line, reader->size - reader->start);
+        reader->size -= reader->start;
+        reader->start = 0;
+        if (reader->capacity - reader->size < READER_CHUNK / 2) {
+            char *data = realloc(reader->data, reader->capacity * 2);
+            if (!data) {
+                fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+                exit(EXIT_FAILURE);
+            }
+            reader->data = data;
+            reader->capacity *= 2;
+        }
+
+        // One byte is kept for the terminator of a last line without newline
+        ssize_t bytes = read(reader->fd, reader->data + reader->size, reader->capacity - reader->size - 1);
+        if (bytes <= 0) {
+            reader->eof = 1;
+        } else {
+            reader->size += (size_t)bytes;
+        }
+    }
+}
+
+void line_reader_destroy(line_reader *reader)
+{
+    free(reader->data);
+    reader->data = NULL;
+}
@@ -0,0 +1,44 @@
+#ifndef INPUT_H_
+#define INPUT_H_
+
+#include <stddef.h>
+
+#define MAX_ARGS 16
+#define READER_CHUNK (64 * 1024)
+
+// Lines of a batch file, read in large chunks and split in place
+typedef struct {
+    int fd;                // file the lines come from
+    char *data;            // chunk being split, lines are null-terminated in place
+    size_t start;          // where the next line starts
+    size_t size;           // bytes read into data
+    size_t capacity;       // bytes allocated for data
+    int eof;               // set when fd has nothing more to read
+} line_reader;
+
+// in batch mode arguments only come from the command line, missing ones are errors
+void input_set_batch(int batch);
+
+// gives the arguments that followed the command name on its line, consumed in order
+// by input_read; they must stay valid until the command is done
+void input_set_args(char **args, int count);
+
+// reads the value asked for by prompt (e.g. "id="): the next argument of the command line if
+// there is one, otherwise a line from stdin after printing the prompt (not in batch mode).
+// Returns 0 on success, -1 if there is no value
+int input_read(const char *prompt, char *value, size_t size);
+
+// splits a command line in place at spaces, keeping "quoted text" (or 'quoted text') together
+// and unescaping \x; returns the number of words, at most max
+int split_command_line(char *line, char **words, int max);
+
+// reads the lines of fd; returns -1 if the buffer can't be allocated
+int line_reader_init(line_reader *reader, int fd);
+
+// returns the next line without its newline, or NULL at the end; the line stays
+// valid until the next call
+char *line_reader_next(line_reader *reader);
+
+void line_reader_destroy(line_reader *reader);
+
+#endif
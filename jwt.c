@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "jwt.h"
+#include "parson.h"
+
+// value of a base64url digit, -1 for anything else
+static int base64url_digit(char c)
+{
+    if (c >= 'A' && c <= 'Z') {
+        return c - 'A';
+    }
+    if (c >= 'a' && c <= 'z') {
+        return c - 'a' + 26;
+    }
+    if (c >= '0' && c <= '9') {
+        return c - '0' + 52;
+    }
+    if (c == '-' || c == '+') {
+        return 62;
+    }
+    if (c == '_' || c == '/') {
+        return 63;
+    }
+    return -1;
+}
+
+// decodes size base64url characters (padding optional) into a new null-terminated string
+static char *base64url_decode(const char *text, size_t size)
+{
+    char *out = malloc(size * 3 / 4 + 1);
+    if (!out) {
+        return NULL;
+    }
+
+    size_t len = 0;
+    unsigned int bits = 0;
+    int count = 0;
+    for (size_t i = 0; i < size && text[i] != '='; i++) {
+        int digit = base64url_digit(text[i]);
+        if (digit < 0) {
+            free(out);
+            return NULL;
+        }
+
+        // Every 4 digits make 3 bytes
+        bits = (bits << 6) | (unsigned int)digit;
+        count += 6;
+        if (count >= 8) {
+            count -= 8;
+            out[len++] = (char)(bits >> count);
+            bits &= (1u << count) - 1;
+        }
+    }
+
+    out[len] = '\0';
+    return out;
+}
+
+time_t jwt_expiry(const char *token)
+{
+    if (!token) {
+        return 0;
+    }
+
+    // header.payload.signature
+    const char *payload = strchr(token, '.');
+    if (!payload) {
+        return 0;
+    }
+    payload++;
+    const char *end = strchr(payload, '.');
+    if (!end) {
+        return 0;
+    }
+
+    char *json = base64url_decode(payload, (size_t)(end - payload));
+    if (!json) {
+        return 0;
+    }
+
+    JSON_Value *value = json_parse_string(json);
+    free(json);
+    if (!value) {
+        return 0;
+    }
+
+    double exp = json_object_get_number(json_value_get_object(value), "exp");
+    json_value_free(value);
+
+    return exp > 0 ? (time_t)exp : 0;
+}
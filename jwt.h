@@ -0,0 +1,10 @@
+#ifndef JWT_H_
+#define JWT_H_
+
+#include <time.h>
+
+// returns the "exp" claim of a JWT (seconds since the epoch) read from its payload,
+// without checking the signature; 0 if the token has none or can't be decoded
+time_t jwt_expiry(const char *token);
+
+#endif
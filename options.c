@@ -0,0 +1,122 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#include "options.h"
+#include "session.h"
+
+static void usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [options] [command [arguments]]\n", program);
+    fprintf(stderr, "  --cache-size BOOKS     books kept in the get_book cache, 0 disables it (default %d)\n",
+            DEFAULT_CACHE_SIZE);
+    fprintf(stderr, "  --cache-ttl SECONDS    seconds a cached book is used before revalidation (default %d)\n",
+            DEFAULT_CACHE_TTL);
+    fprintf(stderr, "  --missing-ttl SECONDS  seconds a missing book id is remembered (default %d)\n",
+            DEFAULT_MISSING_TTL);
+    fprintf(stderr, "  --catalog DIR          keep fetched books in DIR between runs (default off)\n");
+    fprintf(stderr, "  --no-catalog           don't keep books between runs\n");
+    fprintf(stderr, "  --jobs REQUESTS        requests sync sends at the same time (default %d)\n",
+            DEFAULT_JOBS);
+    fprintf(stderr, "  --prefetch BOOKS|all   listed books fetched in the background after get_books,\n"
+                    "                         using idle --jobs threads (default %d, off)\n",
+            DEFAULT_PREFETCH);
+    fprintf(stderr, "  --pipeline REQUESTS    requests add_books writes on a connection before reading\n"
+                    "                         the responses (default %d)\n",
+            DEFAULT_PIPELINE);
+    fprintf(stderr, "  --stream               get_book with several ids prints the books as they arrive,\n"
+                    "                         not in the order they were given\n");
+    fprintf(stderr, "  --batch FILE           run the commands of FILE (- for stdin), one per line with\n"
+                    "                         their arguments (e.g. get_book 42), without prompts\n");
+    fprintf(stderr, "  --no-preconnect        don't connect for the next command while it is typed\n");
+    fprintf(stderr, "  --stats                print connection counts and wait times at exit\n");
+    fprintf(stderr, "  --session FILE         keep the login and library access in FILE, encrypted,\n"
+                    "                         so the next run (e.g. %s --session FILE get_books)\n"
+                    "                         doesn't log in again\n", program);
+    fprintf(stderr, "  --session-key FILE     key of the session file, created if missing (default\n"
+                    "                         ~/%s, or $%s as 64 hex digits)\n",
+            SESSION_KEY_FILE, SESSION_KEY_ENV);
+    fprintf(stderr, "  --users FILE           named sessions, one \"name username password\" per line;\n"
+                    "                         @name COMMAND runs a command in one, @* COMMAND in all\n");
+    exit(EXIT_FAILURE);
+}
+
+static long parse_count(const char *program, const char *value)
+{
+    char *end;
+
+    // Only plain non-negative numbers are accepted
+    long number = value ? strtol(value, &end, 10) : -1;
+    if (!value || *value == '\0' || *end != '\0' || number < 0) {
+        usage(program);
+    }
+
+    return number;
+}
+
+void parse_options(int argc, char *argv[], client_options *options)
+{
+    // Start from the defaults
+    options->cache_size = DEFAULT_CACHE_SIZE;
+    options->cache_ttl = DEFAULT_CACHE_TTL;
+    options->missing_ttl = DEFAULT_MISSING_TTL;
+    options->catalog_dir = NULL;
+    options->jobs = DEFAULT_JOBS;
+    options->prefetch = DEFAULT_PREFETCH;
+    options->pipeline = DEFAULT_PIPELINE;
+    options->stream = 0;
+    options->batch = NULL;
+    options->preconnect = 1;
+    options->stats = 0;
+    options->session = NULL;
+    options->session_key = NULL;
+    options->users = NULL;
+    options->command = NULL;
+    options->command_count = 0;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--cache-size")) {
+            options->cache_size = (size_t)parse_count(argv[0], argv[++i]);
+        } else if (!strcmp(argv[i], "--cache-ttl")) {
+            options->cache_ttl = (int)parse_count(argv[0], argv[++i]);
+        } else if (!strcmp(argv[i], "--missing-ttl")) {
+            options->missing_ttl = (int)parse_count(argv[0], argv[++i]);
+        } else if ((!strcmp(argv[i], "--catalog") || !strcmp(argv[i], "--catalog-dir")) &&
+                   argv[i + 1] && argv[i + 1][0]) {
+            options->catalog_dir = argv[++i];
+        } else if (!strcmp(argv[i], "--no-catalog")) {
+            options->catalog_dir = NULL;
+        } else if (!strcmp(argv[i], "--jobs")) {
+            options->jobs = (size_t)parse_count(argv[0], argv[++i]);
+        } else if (!strcmp(argv[i], "--prefetch") && argv[i + 1] && !strcmp(argv[i + 1], "all")) {
+            options->prefetch = SIZE_MAX;
+            i++;
+        } else if (!strcmp(argv[i], "--prefetch")) {
+            options->prefetch = (size_t)parse_count(argv[0], argv[++i]);
+        } else if (!strcmp(argv[i], "--pipeline")) {
+            options->pipeline = (size_t)parse_count(argv[0], argv[++i]);
+        } else if (!strcmp(argv[i], "--stream")) {
+            options->stream = 1;
+        } else if (!strcmp(argv[i], "--batch") && argv[i + 1] && argv[i + 1][0]) {
+            options->batch = argv[++i];
+        } else if (!strcmp(argv[i], "--no-preconnect")) {
+            options->preconnect = 0;
+        } else if (!strcmp(argv[i], "--stats")) {
+            options->stats = 1;
+        } else if (!strcmp(argv[i], "--session") && argv[i + 1] && argv[i + 1][0]) {
+            options->session = argv[++i];
+        } else if (!strcmp(argv[i], "--session-key") && argv[i + 1] && argv[i + 1][0]) {
+            options->session_key = argv[++i];
+        } else if (!strcmp(argv[i], "--users") && argv[i + 1] && argv[i + 1][0]) {
+            options->users = argv[++i];
+        } else if (argv[i][0] != '-') {
+            // the rest is the command and its arguments
+            options->command = argv + i;
+            options->command_count = argc - i;
+            break;
+        } else {
+            usage(argv[0]);
+        }
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef OPTIONS_H_
+#define OPTIONS_H_
+
+#include <stddef.h>
+
+#define DEFAULT_CACHE_SIZE 256
+#define DEFAULT_CACHE_TTL 30
+#define DEFAULT_MISSING_TTL 5
+#define DEFAULT_JOBS 4
+#define DEFAULT_PREFETCH 0
+#define DEFAULT_PIPELINE 8
+
+// Settings given on the command line
+typedef struct {
+    size_t cache_size; // books kept by the get_book cache, 0 disables it
+    int cache_ttl;     // seconds a cached book is served without asking the server
+    int missing_ttl;   // seconds a 404 for a book id is remembered
+    const char *catalog_dir; // directory of the per-user on-disk catalogs, NULL (the default) disables them
+    size_t jobs;       // requests sync runs at the same time, 0 runs them one by one
+    size_t prefetch;   // listed books fetched in the background after get_books, 0 disables it
+    size_t pipeline;   // requests bulk commands write on a connection before reading the responses
+    int stream;        // get_book with several ids prints the books as they arrive
+    const char *batch; // file of commands run without prompts ("-" for stdin), NULL for interactive use
+    int preconnect;    // interactive commands get a connection opened while they are typed
+    int stats;         // print connection counts and wait times at exit
+    const char *session;     // encrypted file keeping the session between runs, NULL to not keep it
+    const char *session_key; // key file for the session, NULL for the default one
+    const char *users; // file of named sessions and their credentials, NULL for none
+    char **command;    // command given after the options, run instead of reading commands
+    int command_count; // words in command
+} client_options;
+
+// fills options from argv, printing the usage and exiting on invalid arguments;
+// the first argument that isn't an option starts a command to run once
+void parse_options(int argc, char *argv[], client_options *options);
+
+#endif
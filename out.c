@@ -0,0 +1,118 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#include "out.h"
+
+// Output not written yet
+static char pending[OUT_BUFFER];
+static size_t pending_size;
+
+// writes all the pieces to stdout, resuming after short writes
+static void write_all(struct iovec *pieces, int count)
+{
+    while (count > 0) {
+        ssize_t bytes = writev(STDOUT_FILENO, pieces, count);
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            // nobody is reading anymore (e.g. a closed pipe), the output is dropped
+            return;
+        }
+
+        // Skip what was written
+        while (count > 0 && (size_t)bytes >= pieces->iov_len) {
+            bytes -= pieces->iov_len;
+            pieces++;
+            count--;
+        }
+        if (count > 0) {
+            pieces->iov_base = (char *)pieces->iov_base + bytes;
+            pieces->iov_len -= bytes;
+        }
+    }
+}
+
+void out_flush(void)
+{
+    if (pending_size == 0) {
+        return;
+    }
+
+    struct iovec piece = { pending, pending_size };
+    write_all(&piece, 1);
+    pending_size = 0;
+}
+
+void out_printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int len = vsnprintf(pending + pending_size, sizeof(pending) - pending_size, format, args);
+    va_end(args);
+
+    if (len < 0) {
+        return;
+    }
+
+    if ((size_t)len < sizeof(pending) - pending_size) {
+        pending_size += len;
+        return;
+    }
+
+    // Didn't fit: make room and format again
+    out_flush();
+    if ((size_t)len < sizeof(pending)) {
+        va_start(args, format);
+        vsnprintf(pending, sizeof(pending), format, args);
+        va_end(args);
+        pending_size = len;
+        return;
+    }
+
+    // Longer than the whole buffer
+    char *text = malloc(len + 1);
+    if (!text) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    va_start(args, format);
+    vsnprintf(text, len + 1, format, args);
+    va_end(args);
+
+    struct iovec piece = { text, (size_t)len };
+    write_all(&piece, 1);
+    free(text);
+}
+
+void out_line(const char *text)
+{
+    size_t len = strlen(text);
+
+    // Short lines are just copied
+    if (len < OUT_DIRECT) {
+        if (len + 1 > sizeof(pending) - pending_size) {
+            out_flush();
+        }
+        memcpy(pending + pending_size, text, len);
+        pending[pending_size + len] = '\n';
+        pending_size += len + 1;
+        return;
+    }
+
+    // What was buffered before, the text and its newline go out together
+    struct iovec pieces[3] = {
+        { pending, pending_size },
+        { (char *)text, len },
+        { "\n", 1 },
+    };
+    write_all(pieces, 3);
+    pending_size = 0;
+}
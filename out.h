@@ -0,0 +1,24 @@
+#ifndef OUT_H_
+#define OUT_H_
+
+#include <stddef.h>
+
+#define OUT_BUFFER (64 * 1024)
+// text at least this long is written from where it is instead of being copied
+#define OUT_DIRECT (16 * 1024)
+
+// Everything the client prints to stdout goes through here: it is collected in one
+// reusable buffer and written once per command (or when the buffer fills up, or before
+// a prompt) instead of on every printf
+
+// formats like printf into the buffer
+void out_printf(const char *format, ...);
+
+// prints text followed by a newline; long text (e.g. a book listing) is written straight
+// from the caller's memory, together with what is buffered, in a single system call
+void out_line(const char *text);
+
+// writes the buffered output to stdout
+void out_flush(void);
+
+#endif
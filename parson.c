@@ -48,6 +48,15 @@
 #include <math.h>
 #include <errno.h>
 
+#if defined(__SSE2__) && !defined(PARSON_NO_SIMD)
+#include <emmintrin.h>
+#define PARSON_SSE2
+#endif
+
+#ifdef PARSON_ENABLE_THREADS
+#include <pthread.h>
+#endif
+
 /* Apparently sscanf is not implemented in some "standard" libraries, so don't use it, if you
  * don't have to. */
 #ifdef sscanf
@@ -80,6 +89,7 @@
 #define SKIP_CHAR(str)        ((*str)++)
 #define SKIP_WHITESPACES(str) while (isspace((unsigned char)(**str))) { SKIP_CHAR(str); }
 #define MAX(a, b)             ((a) > (b) ? (a) : (b))
+#define MIN(a, b)             ((a) < (b) ? (a) : (b))
 
 #undef malloc
 #undef free
@@ -92,6 +102,23 @@
 
 #define OBJECT_INVALID_IX ((size_t)-1)
 
+/* Objects keep one control byte per cell: CTRL_EMPTY or 7 bits of the item's hash,
+   so a whole group of cells can be probed at once before comparing any keys.
+   The first CTRL_GROUP_WIDTH bytes are mirrored after the last cell, which lets
+   a group starting near the end of the table be loaded without wrapping. */
+#define CTRL_EMPTY       ((unsigned char)0x80)
+#define CTRL_GROUP_WIDTH 16
+#define CTRL_H2(hash)    ((unsigned char)(((hash) >> (sizeof(unsigned long) * 8 - 7)) & 0x7F))
+
+/* Objects with at most this many items are searched with a plain scan of their
+   names, which is faster than hashing the name for the few keys involved. */
+#ifndef PARSON_OBJECT_SCAN_MAX
+#define PARSON_OBJECT_SCAN_MAX 8
+#endif
+
+/* Each array in an object's single table allocation starts at this alignment */
+#define TABLE_ALIGN(n) (((n) + 15) & ~(size_t)15)
+
 static JSON_Malloc_Function parson_malloc = malloc;
 static JSON_Free_Function parson_free = free;
 
@@ -101,6 +128,33 @@ static char *parson_float_format = NULL;
 
 static JSON_Number_Serialization_Function parson_number_serialization_function = NULL;
 
+static int parson_key_interning = 0;
+
+static int parson_node_pooling = 0;
+
+/* Thread local storage for the node pools, so parsing on several threads stays safe */
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L && !defined(__STDC_NO_THREADS__)
+#define PARSON_THREAD_LOCAL _Thread_local
+#elif defined(__GNUC__)
+#define PARSON_THREAD_LOCAL __thread
+#elif defined(_MSC_VER)
+#define PARSON_THREAD_LOCAL __declspec(thread)
+#else
+#define PARSON_THREAD_LOCAL /* pools are shared, node pooling isn't thread safe */
+#endif
+
+#ifndef PARSON_POOL_MAX_BLOCKS
+#define PARSON_POOL_MAX_BLOCKS 4096 /* per pool and thread, anything above goes back to free */
+#endif
+
+#ifndef PARSON_PARALLEL_MAX_THREADS
+#define PARSON_PARALLEL_MAX_THREADS 64
+#endif
+
+#ifndef PARSON_PARALLEL_MIN_CHUNK
+#define PARSON_PARALLEL_MIN_CHUNK (64 * 1024) /* bytes of input below which another thread isn't worth it */
+#endif
+
 #define IS_CONT(b) (((unsigned char)(b) & 0xC0) == 0x80) /* is utf-8 continuation byte */
 
 typedef int parson_bool_t;
@@ -113,6 +167,52 @@ typedef struct json_string {
     size_t length;
 } JSON_String;
 
+/* Object keys are immutable, reference counted strings. The header is stored
+   right before the characters, so names[] can still be handed out as plain
+   null terminated strings while length and hash are known without rescanning. */
+typedef struct json_key {
+    size_t        refcount;
+    size_t        length;
+    unsigned long hash;
+} JSON_Key;
+
+#define KEY_HEADER(key) (((JSON_Key*)(key)) - 1)
+
+/* Per-parse table used to share identical keys between objects */
+typedef struct json_key_table {
+    char  **keys;
+    size_t  count;
+    size_t  capacity;
+} JSON_Key_Table;
+
+/* Free lists of recycled fixed size blocks. A block's first word links it to the next one. */
+typedef struct json_pool {
+    void   *head;
+    size_t  count;
+} JSON_Pool;
+
+enum json_pool_type {
+    POOL_VALUE = 0,
+    POOL_OBJECT,
+    POOL_ARRAY,
+    POOL_OBJECT_TABLE,  /* tables of objects with STARTING_CAPACITY cells */
+    POOL_ARRAY_ITEMS,   /* items of arrays with STARTING_CAPACITY capacity */
+    POOL_TYPES_COUNT
+};
+
+static PARSON_THREAD_LOCAL JSON_Pool parson_pools[POOL_TYPES_COUNT];
+
+/* Part of a top-level array parsed on its own, from its first element up to
+   the comma or closing bracket following its last one */
+typedef struct json_array_chunk {
+    const char *start;
+    const char *end;
+    JSON_Value *result;
+} JSON_Array_Chunk;
+
+#define KEY_TABLE_STARTING_CAPACITY 64
+#define KEY_TABLE_MAX_KEYS          4096 /* stop interning documents made of unique keys */
+
 /* Type definitions */
 typedef union json_value_value {
     JSON_String  string;
@@ -131,7 +231,8 @@ struct json_value_t {
 
 struct json_object_t {
     JSON_Value    *wrapping_value;
-    size_t        *cells;
+    size_t        *cells;  /* start of the table, all arrays below share its allocation */
+    unsigned char *ctrl;
     unsigned long *hashes;
     char         **names;
     JSON_Value   **values;
@@ -148,12 +249,95 @@ struct json_array_t {
     size_t       capacity;
 };
 
+/* Read-only document stored as one contiguous array of values (the tape).
+   Containers are followed by their whole subtree, objects store each member
+   as a key value immediately followed by the member's value. */
+struct json_tape_value_t {
+    JSON_Value_Type type;
+    unsigned int    length; /* bytes in a string, items in an array, members in an object */
+    union {
+        double              number;
+        int                 boolean;
+        const char         *string;
+        const unsigned int *items;  /* distance from the container to each item (or member key) */
+        size_t              items_ix; /* position of items in the parser's index, only while parsing */
+    } as;
+};
+
+/* Lazily parsed document: only the top-level object or array is indexed,
+   each member is parsed the first time it's accessed. */
+typedef struct json_lazy_member {
+    const char *name;   /* NULL for array items */
+    size_t      name_len;
+    const char *start;  /* first character of the raw value */
+    JSON_Value *value;  /* NULL until materialized */
+} JSON_Lazy_Member;
+
+struct json_lazy_t {
+    char             *buffer; /* copy of the source, top-level keys are unescaped in place */
+    JSON_Value_Type   type;
+    JSON_Lazy_Member *members;
+    size_t            count;
+    size_t            capacity;
+};
+
+/* Dotted name split once into segments with precomputed hashes */
+typedef struct json_path_segment {
+    const char   *name;
+    size_t        length;
+    unsigned long hash;
+} JSON_Path_Segment;
+
+struct json_path_t {
+    char              *names; /* copy of the dotted name, segments point into it */
+    JSON_Path_Segment *segments;
+    size_t             count;
+};
+
+struct json_tape_t {
+    char            *buffer; /* copy of the source, strings are unescaped in place */
+    JSON_Tape_Value *values;
+    unsigned int    *items;
+};
+
+typedef struct json_tape_parser {
+    JSON_Tape_Value *values;
+    size_t           values_count;
+    size_t           values_capacity;
+    unsigned int    *items;
+    size_t           items_count;
+    size_t           items_capacity;
+    size_t          *pending;  /* items of the containers being parsed */
+    size_t           pending_count;
+    size_t           pending_capacity;
+} JSON_Tape_Parser;
+
+#define TAPE_MAX_LENGTH ((unsigned int)-1)
+
+/* JSON Lazy */
+static JSON_Status  lazy_add_member(JSON_Lazy *lazy, const char *name, size_t name_len, const char *start);
+static JSON_Status  lazy_index(JSON_Lazy *lazy, char *string);
+static JSON_Value * lazy_materialize(JSON_Lazy_Member *member);
+
+/* JSON Tape */
+static JSON_Status  tape_push_value(JSON_Tape_Parser *parser, JSON_Value_Type type);
+static JSON_Status  tape_push_item(JSON_Tape_Parser *parser, size_t value_ix);
+static JSON_Status  tape_close_container(JSON_Tape_Parser *parser, size_t container_ix, size_t items_start);
+static JSON_Status  tape_parse_string(JSON_Tape_Parser *parser, char **string);
+static JSON_Status  tape_parse_object(JSON_Tape_Parser *parser, char **string, size_t nesting);
+static JSON_Status  tape_parse_array(JSON_Tape_Parser *parser, char **string, size_t nesting);
+static JSON_Status  tape_parse_value(JSON_Tape_Parser *parser, char **string, size_t nesting);
+static const JSON_Tape_Value * tape_object_find(const JSON_Tape_Value *object, const char *name);
+
 /* Various */
 static char * read_file(const char *filename);
 static void   remove_comments(char *string, const char *start_token, const char *end_token);
 static char * parson_strndup(const char *string, size_t n);
 static char * parson_strdup(const char *string);
 static int    parson_sprintf(char * s, const char * format, ...);
+static void * pool_malloc(int pool, size_t size);
+static void   pool_free(int pool, void *block);
+static void   pool_drain(void);
 
 static int    hex_char_to_int(char c);
 static JSON_Status parse_utf16_hex(const char *string, unsigned int *result);
@@ -163,14 +347,26 @@ static parson_bool_t is_valid_utf8(const char *string, size_t string_len);
 static parson_bool_t is_decimal(const char *string, size_t length);
 static unsigned long hash_string(const char *string, size_t n);
 
+/* JSON Key */
+static char *        key_make(const char *string, size_t length, unsigned long hash);
+static char *        key_retain(char *key);
+static void          key_release(char *key);
+static void          key_table_deinit(JSON_Key_Table *table);
+static JSON_Status   key_table_grow(JSON_Key_Table *table);
+static char *        key_table_intern(JSON_Key_Table *table, const char *string, size_t length);
+
 /* JSON Object */
 static JSON_Object * json_object_make(JSON_Value *wrapping_value);
 static JSON_Status   json_object_init(JSON_Object *object, size_t capacity);
 static void          json_object_deinit(JSON_Object *object, parson_bool_t free_keys, parson_bool_t free_values);
 static JSON_Status   json_object_grow_and_rehash(JSON_Object *object);
 static size_t        json_object_get_cell_ix(const JSON_Object *object, const char *key, size_t key_len, unsigned long hash, parson_bool_t *out_found);
+static size_t        json_object_scan(const JSON_Object *object, const char *key, size_t key_len);
+static void          json_object_set_cell(JSON_Object *object, size_t cell_ix, size_t item_ix);
+static unsigned int  ctrl_match(const unsigned char *group, unsigned char h2, unsigned int *out_empty);
 static JSON_Status   json_object_add(JSON_Object *object, char *name, JSON_Value *value);
 static JSON_Value  * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len);
+static JSON_Value  * json_object_getn_value_hashed(const JSON_Object *object, const char *name, size_t name_len, unsigned long hash);
 static JSON_Status   json_object_remove_internal(JSON_Object *object, const char *name, parson_bool_t free_value);
 static JSON_Status   json_object_dotremove_internal(JSON_Object *object, const char *name, parson_bool_t free_value);
 static void          json_object_free(JSON_Object *object);
@@ -179,6 +375,7 @@ static void          json_object_free(JSON_Object *object);
 static JSON_Array * json_array_make(JSON_Value *wrapping_value);
 static JSON_Status  json_array_add(JSON_Array *array, JSON_Value *value);
 static JSON_Status  json_array_resize(JSON_Array *array, size_t new_capacity);
+static void         json_array_free_items(JSON_Array *array);
 static void         json_array_free(JSON_Array *array);
 
 /* JSON Value */
@@ -188,15 +385,25 @@ static const JSON_String * json_value_get_string_desc(const JSON_Value *value);
 /* Parser */
 static JSON_Status   skip_quotes(const char **string);
 static JSON_Status   parse_utf16(const char **unprocessed, char **processed);
+static JSON_Status   unescape_string(const char *input, size_t input_len, char *output, size_t *output_len);
 static char *        process_string(const char *input, size_t input_len, size_t *output_len);
 static char *        get_quoted_string(const char **string, size_t *output_string_len);
-static JSON_Value *  parse_object_value(const char **string, size_t nesting);
-static JSON_Value *  parse_array_value(const char **string, size_t nesting);
+static char *        get_object_key(const char **string, JSON_Key_Table *keys);
+static JSON_Value *  parse_object_value(const char **string, size_t nesting, JSON_Key_Table *keys);
+static JSON_Value *  parse_array_value(const char **string, size_t nesting, JSON_Key_Table *keys);
 static JSON_Value *  parse_string_value(const char **string);
 static JSON_Value *  parse_boolean_value(const char **string);
 static JSON_Value *  parse_number_value(const char **string);
 static JSON_Value *  parse_null_value(const char **string);
-static JSON_Value *  parse_value(const char **string, size_t nesting);
+static JSON_Value *  parse_value(const char **string, size_t nesting, JSON_Key_Table *keys);
+static JSON_Value *  parse_root_value(const char **string, size_t nesting);
+static JSON_Status   skip_value(const char **string);
+#ifdef PARSON_ENABLE_THREADS
+static size_t        split_array(const char *string, size_t length, const char **bounds, size_t parts);
+static JSON_Value *  parse_array_chunk(const char *string, const char *end);
+static void *        parse_array_chunk_thread(void *chunk);
+static JSON_Value *  join_array_chunks(JSON_Array_Chunk *chunks, size_t count);
+#endif
 
 /* Serialization */
 static int json_serialize_to_buffer_r(const JSON_Value *value, char *buf, int level, parson_bool_t is_pretty, char *num_buf);
@@ -286,6 +493,44 @@ static char * parson_strdup(const char *string) {
     return parson_strndup(string, strlen(string));
 }
 
+static void * pool_malloc(int pool, size_t size) {
+    JSON_Pool *free_list = &parson_pools[pool];
+    void *block = free_list->head;
+    if (block == NULL) {
+        return parson_malloc(size);
+    }
+    free_list->head = *(void**)block;
+    free_list->count--;
+    return block;
+}
+
+static void pool_free(int pool, void *block) {
+    JSON_Pool *free_list = &parson_pools[pool];
+    if (block == NULL) {
+        return;
+    }
+    if (!parson_node_pooling || free_list->count >= PARSON_POOL_MAX_BLOCKS) {
+        parson_free(block);
+        return;
+    }
+    *(void**)block = free_list->head;
+    free_list->head = block;
+    free_list->count++;
+}
+
+static void pool_drain(void) {
+    void *block = NULL;
+    int i = 0;
+    for (i = 0; i < POOL_TYPES_COUNT; i++) {
+        while (parson_pools[i].head != NULL) {
+            block = parson_pools[i].head;
+            parson_pools[i].head = *(void**)block;
+            parson_free(block);
+        }
+        parson_pools[i].count = 0;
+    }
+}
+
 static int parson_sprintf(char * s, const char * format, ...) {
     int result;
     va_list args;
@@ -416,37 +661,172 @@ static parson_bool_t is_decimal(const char *string, size_t length) {
     return PARSON_TRUE;
 }
 
+#ifndef PARSON_FORCE_HASH_COLLISIONS
+#define HASH_P0 0xa0761d6478bd642fULL
+#define HASH_P1 0xe7037ed1a0b428dbULL
+#define HASH_P2 0x8ebc6af09c88c6e3ULL
+
+/* 64x64 bit multiplication folded back to 64 bits */
+static unsigned long long hash_mum(unsigned long long a, unsigned long long b) {
+#if defined(__SIZEOF_INT128__)
+    __uint128_t r = (__uint128_t)a * b;
+    return (unsigned long long)(r >> 64) ^ (unsigned long long)r;
+#else
+    unsigned long long ha = a >> 32, hb = b >> 32, la = (unsigned int)a, lb = (unsigned int)b;
+    unsigned long long rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    unsigned long long t = rl + (rm0 << 32), lo = t + (rm1 << 32);
+    unsigned long long hi = rh + (rm0 >> 32) + (rm1 >> 32) + (t < rl) + (lo < t);
+    return hi ^ lo;
+#endif
+}
+
+/* Reads up to 8 bytes into a word, padding with zeroes */
+static unsigned long long hash_read(const char *string, size_t n) {
+    unsigned long long word = 0;
+    memcpy(&word, string, n);
+    return word;
+}
+
+#endif
+
+/* Word at a time hash in the spirit of wyhash: 16 bytes are mixed per multiplication */
 static unsigned long hash_string(const char *string, size_t n) {
 #ifdef PARSON_FORCE_HASH_COLLISIONS
     (void)string;
     (void)n;
     return 0;
 #else
-    unsigned long hash = 5381;
-    unsigned char c;
+    unsigned long long seed = HASH_P0 ^ n;
+    size_t remaining = n;
+    while (remaining > 16) {
+        seed = hash_mum(hash_read(string, 8) ^ HASH_P1, hash_read(string + 8, 8) ^ seed);
+        string += 16;
+        remaining -= 16;
+    }
+    if (remaining > 8) {
+        seed = hash_mum(hash_read(string, 8) ^ HASH_P1, hash_read(string + 8, remaining - 8) ^ seed);
+    } else {
+        seed = hash_mum(hash_read(string, remaining) ^ HASH_P1, seed);
+    }
+    return (unsigned long)hash_mum(seed ^ HASH_P2, (unsigned long long)n ^ HASH_P1);
+#endif
+}
+
+/* JSON Key */
+static char * key_make(const char *string, size_t length, unsigned long hash) {
+    JSON_Key *header = (JSON_Key*)parson_malloc(sizeof(JSON_Key) + length + 1);
+    char *key = NULL;
+    if (header == NULL) {
+        return NULL;
+    }
+    header->refcount = 1;
+    header->length = length;
+    header->hash = hash;
+    key = (char*)(header + 1);
+    memcpy(key, string, length);
+    key[length] = '\0';
+    return key;
+}
+
+static char * key_retain(char *key) {
+    KEY_HEADER(key)->refcount++;
+    return key;
+}
+
+static void key_release(char *key) {
+    JSON_Key *header = NULL;
+    if (key == NULL) {
+        return;
+    }
+    header = KEY_HEADER(key);
+    header->refcount--;
+    if (header->refcount == 0) {
+        parson_free(header);
+    }
+}
+
+static void key_table_deinit(JSON_Key_Table *table) {
     size_t i = 0;
-    for (i = 0; i < n; i++) {
-        c = string[i];
-        if (c == '\0') {
-            break;
+    for (i = 0; i < table->capacity; i++) {
+        key_release(table->keys[i]);
+    }
+    parson_free(table->keys);
+    table->keys = NULL;
+    table->count = 0;
+    table->capacity = 0;
+}
+
+static JSON_Status key_table_grow(JSON_Key_Table *table) {
+    size_t new_capacity = MAX(table->capacity * 2, KEY_TABLE_STARTING_CAPACITY);
+    char **new_keys = (char**)parson_malloc(new_capacity * sizeof(char*));
+    size_t i = 0, ix = 0;
+    if (new_keys == NULL) {
+        return JSONFailure;
+    }
+    memset(new_keys, 0, new_capacity * sizeof(char*));
+    for (i = 0; i < table->capacity; i++) {
+        if (table->keys[i] == NULL) {
+            continue;
         }
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
+        ix = KEY_HEADER(table->keys[i])->hash & (new_capacity - 1);
+        while (new_keys[ix] != NULL) {
+            ix = (ix + 1) & (new_capacity - 1);
+        }
+        new_keys[ix] = table->keys[i];
     }
-    return hash;
-#endif
+    parson_free(table->keys);
+    table->keys = new_keys;
+    table->capacity = new_capacity;
+    return JSONSuccess;
+}
+
+/* Returns a new reference to a key equal to string, sharing it with previous
+   callers when possible. string doesn't have to be null terminated. */
+static char * key_table_intern(JSON_Key_Table *table, const char *string, size_t length) {
+    unsigned long hash = hash_string(string, length);
+    const JSON_Key *header = NULL;
+    char *key = NULL;
+    size_t ix = 0;
+    if (table->capacity > 0) {
+        ix = hash & (table->capacity - 1);
+        while (table->keys[ix] != NULL) {
+            header = KEY_HEADER(table->keys[ix]);
+            if (header->hash == hash && header->length == length
+                && memcmp(table->keys[ix], string, length) == 0) {
+                return key_retain(table->keys[ix]);
+            }
+            ix = (ix + 1) & (table->capacity - 1);
+        }
+    }
+    key = key_make(string, length, hash);
+    if (key == NULL || table->count >= KEY_TABLE_MAX_KEYS) {
+        return key;
+    }
+    if ((table->count + 1) * 10 > table->capacity * 7) {
+        if (key_table_grow(table) != JSONSuccess) {
+            return key; /* interning is best effort */
+        }
+        ix = hash & (table->capacity - 1);
+        while (table->keys[ix] != NULL) {
+            ix = (ix + 1) & (table->capacity - 1);
+        }
+    }
+    table->keys[ix] = key_retain(key);
+    table->count++;
+    return key;
 }
 
 /* JSON Object */
 static JSON_Object * json_object_make(JSON_Value *wrapping_value) {
     JSON_Status res = JSONFailure;
-    JSON_Object *new_obj = (JSON_Object*)parson_malloc(sizeof(JSON_Object));
+    JSON_Object *new_obj = (JSON_Object*)pool_malloc(POOL_OBJECT, sizeof(JSON_Object));
     if (new_obj == NULL) {
         return NULL;
     }
     new_obj->wrapping_value = wrapping_value;
     res = json_object_init(new_obj, 0);
     if (res != JSONSuccess) {
-        parson_free(new_obj);
+        pool_free(POOL_OBJECT, new_obj);
         return NULL;
     }
     return new_obj;
@@ -454,8 +834,12 @@ static JSON_Object * json_object_make(JSON_Value *wrapping_value) {
 
 static JSON_Status json_object_init(JSON_Object *object, size_t capacity) {
     unsigned int i = 0;
+    size_t names_offset = 0, values_offset = 0, cell_ixs_offset = 0;
+    size_t hashes_offset = 0, ctrl_offset = 0, table_size = 0;
+    char *table = NULL;
 
     object->cells = NULL;
+    object->ctrl = NULL;
     object->names = NULL;
     object->values = NULL;
     object->cell_ixs = NULL;
@@ -469,53 +853,57 @@ static JSON_Status json_object_init(JSON_Object *object, size_t capacity) {
         return JSONSuccess;
     }
 
-    object->cells = (size_t*)parson_malloc(object->cell_capacity * sizeof(*object->cells));
-    object->names = (char**)parson_malloc(object->item_capacity * sizeof(*object->names));
-    object->values = (JSON_Value**)parson_malloc(object->item_capacity * sizeof(*object->values));
-    object->cell_ixs = (size_t*)parson_malloc(object->item_capacity * sizeof(*object->cell_ixs));
-    object->hashes = (unsigned long*)parson_malloc(object->item_capacity * sizeof(*object->hashes));
-    if (object->cells == NULL
-        || object->names == NULL
-        || object->values == NULL
-        || object->cell_ixs == NULL
-        || object->hashes == NULL) {
-        goto error;
+    /* all arrays live in one allocation */
+    names_offset = TABLE_ALIGN(object->cell_capacity * sizeof(*object->cells));
+    values_offset = names_offset + TABLE_ALIGN(object->item_capacity * sizeof(*object->names));
+    cell_ixs_offset = values_offset + TABLE_ALIGN(object->item_capacity * sizeof(*object->values));
+    hashes_offset = cell_ixs_offset + TABLE_ALIGN(object->item_capacity * sizeof(*object->cell_ixs));
+    ctrl_offset = hashes_offset + TABLE_ALIGN(object->item_capacity * sizeof(*object->hashes));
+    table_size = ctrl_offset + object->cell_capacity + CTRL_GROUP_WIDTH;
+    if (capacity == STARTING_CAPACITY) {
+        table = (char*)pool_malloc(POOL_OBJECT_TABLE, table_size);
+    } else {
+        table = (char*)parson_malloc(table_size);
+    }
+    if (table == NULL) {
+        return JSONFailure;
     }
+    object->cells = (size_t*)table;
+    object->names = (char**)(table + names_offset);
+    object->values = (JSON_Value**)(table + values_offset);
+    object->cell_ixs = (size_t*)(table + cell_ixs_offset);
+    object->hashes = (unsigned long*)(table + hashes_offset);
+    object->ctrl = (unsigned char*)(table + ctrl_offset);
     for (i = 0; i < object->cell_capacity; i++) {
         object->cells[i] = OBJECT_INVALID_IX;
     }
+    memset(object->ctrl, CTRL_EMPTY, object->cell_capacity + CTRL_GROUP_WIDTH);
     return JSONSuccess;
-error:
-    parson_free(object->cells);
-    parson_free(object->names);
-    parson_free(object->values);
-    parson_free(object->cell_ixs);
-    parson_free(object->hashes);
-    return JSONFailure;
 }
 
 static void json_object_deinit(JSON_Object *object, parson_bool_t free_keys, parson_bool_t free_values) {
     unsigned int i = 0;
     for (i = 0; i < object->count; i++) {
         if (free_keys) {
-            parson_free(object->names[i]);
+            key_release(object->names[i]);
         }
         if (free_values) {
             json_value_free(object->values[i]);
         }
     }
 
+    if (object->cell_capacity == STARTING_CAPACITY) {
+        pool_free(POOL_OBJECT_TABLE, object->cells);
+    } else {
+        parson_free(object->cells); /* frees the whole table */
+    }
+
     object->count = 0;
     object->item_capacity = 0;
     object->cell_capacity = 0;
 
-    parson_free(object->cells);
-    parson_free(object->names);
-    parson_free(object->values);
-    parson_free(object->cell_ixs);
-    parson_free(object->hashes);
-
     object->cells = NULL;
+    object->ctrl = NULL;
     object->names = NULL;
     object->values = NULL;
     object->cell_ixs = NULL;
@@ -552,37 +940,91 @@ static JSON_Status json_object_grow_and_rehash(JSON_Object *object) {
     return JSONSuccess;
 }
 
+/* Returns a bit per byte of group equal to h2 and stores a bit per empty byte in out_empty */
+static unsigned int ctrl_match(const unsigned char *group, unsigned char h2, unsigned int *out_empty) {
+#ifdef PARSON_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    *out_empty = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)CTRL_EMPTY)));
+    return (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)h2)));
+#else
+    unsigned int i = 0, match = 0, empty = 0;
+    for (i = 0; i < CTRL_GROUP_WIDTH; i++) {
+        match |= (unsigned int)(group[i] == h2) << i;
+        empty |= (unsigned int)(group[i] == CTRL_EMPTY) << i;
+    }
+    *out_empty = empty;
+    return match;
+#endif
+}
+
+/* Linear probing, one group of control bytes at a time: only cells whose control
+   byte matches the hash are compared, and the probe ends at the first empty cell. */
 static size_t json_object_get_cell_ix(const JSON_Object *object, const char *key, size_t key_len, unsigned long hash, parson_bool_t *out_found) {
-    size_t cell_ix = hash & (object->cell_capacity - 1);
+    size_t mask = object->cell_capacity - 1;
+    size_t group_ix = hash & mask;
     size_t cell = 0;
     size_t ix = 0;
-    unsigned int i = 0;
-    unsigned long hash_to_check = 0;
+    size_t probed = 0;
+    unsigned int match = 0, empty = 0, bit = 0;
+    unsigned char h2 = CTRL_H2(hash);
     const char *key_to_check = NULL;
-    size_t key_to_check_len = 0;
 
     *out_found = PARSON_FALSE;
 
-    for (i = 0; i < object->cell_capacity; i++) {
-        ix = (cell_ix + i) & (object->cell_capacity - 1);
-        cell = object->cells[ix];
-        if (cell == OBJECT_INVALID_IX) {
-            return ix;
+    if (object->cell_capacity == 0) {
+        return OBJECT_INVALID_IX;
+    }
+
+    for (probed = 0; probed < object->cell_capacity; probed += CTRL_GROUP_WIDTH) {
+        match = ctrl_match(object->ctrl + group_ix, h2, &empty);
+        if (empty) {
+            match &= (empty & (0u - empty)) - 1; /* ignore matches past the first empty cell */
         }
-        hash_to_check = object->hashes[cell];
-        if (hash != hash_to_check) {
-            continue;
+        for (bit = 0; match != 0; bit++, match >>= 1) {
+            if (!(match & 1)) {
+                continue;
+            }
+            ix = (group_ix + bit) & mask;
+            cell = object->cells[ix];
+            if (object->hashes[cell] != hash) {
+                continue;
+            }
+            key_to_check = object->names[cell];
+            if (KEY_HEADER(key_to_check)->length == key_len && memcmp(key, key_to_check, key_len) == 0) {
+                *out_found = PARSON_TRUE;
+                return ix;
+            }
         }
-        key_to_check = object->names[cell];
-        key_to_check_len = strlen(key_to_check);
-        if (key_to_check_len == key_len && strncmp(key, key_to_check, key_len) == 0) {
-            *out_found = PARSON_TRUE;
-            return ix;
+        if (empty) {
+            for (bit = 0; !(empty & 1); bit++, empty >>= 1);
+            return (group_ix + bit) & mask;
         }
+        group_ix = (group_ix + CTRL_GROUP_WIDTH) & mask;
     }
     return OBJECT_INVALID_IX;
 }
 
+/* Returns item index of key in a small object without hashing it */
+static size_t json_object_scan(const JSON_Object *object, const char *key, size_t key_len) {
+    size_t i = 0;
+    for (i = 0; i < object->count; i++) {
+        if (KEY_HEADER(object->names[i])->length == key_len && memcmp(object->names[i], key, key_len) == 0) {
+            return i;
+        }
+    }
+    return OBJECT_INVALID_IX;
+}
+
+/* Points cell_ix at item_ix (or clears it when item_ix is OBJECT_INVALID_IX) and updates its control byte */
+static void json_object_set_cell(JSON_Object *object, size_t cell_ix, size_t item_ix) {
+    unsigned char ctrl = item_ix == OBJECT_INVALID_IX ? CTRL_EMPTY : CTRL_H2(object->hashes[item_ix]);
+    object->cells[cell_ix] = item_ix;
+    object->ctrl[cell_ix] = ctrl;
+    if (cell_ix < CTRL_GROUP_WIDTH) {
+        object->ctrl[object->cell_capacity + cell_ix] = ctrl;
+    }
+}
+
 static JSON_Status json_object_add(JSON_Object *object, char *name, JSON_Value *value) {
     unsigned long hash = 0;
     parson_bool_t found = PARSON_FALSE;
@@ -593,9 +1035,9 @@ static JSON_Status json_object_add(JSON_Object *object, char *name, JSON_Value *
         return JSONFailure;
     }
 
-    hash = hash_string(name, strlen(name));
+    hash = KEY_HEADER(name)->hash;
     found = PARSON_FALSE;
-    cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
+    cell_ix = json_object_get_cell_ix(object, name, KEY_HEADER(name)->length, hash, &found);
     if (found) {
         return JSONFailure;
     }
@@ -605,14 +1047,14 @@ static JSON_Status json_object_add(JSON_Object *object, char *name, JSON_Value *
         if (res != JSONSuccess) {
             return JSONFailure;
         }
-        cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
+        cell_ix = json_object_get_cell_ix(object, name, KEY_HEADER(name)->length, hash, &found);
     }
 
     object->names[object->count] = name;
-    object->cells[cell_ix] = object->count;
     object->values[object->count] = value;
     object->cell_ixs[object->count] = cell_ix;
     object->hashes[object->count] = hash;
+    json_object_set_cell(object, cell_ix, object->count);
     object->count++;
     value->parent = json_object_get_wrapping_value(object);
 
@@ -620,14 +1062,28 @@ static JSON_Status json_object_add(JSON_Object *object, char *name, JSON_Value *
 }
 
 static JSON_Value * json_object_getn_value(const JSON_Object *object, const char *name, size_t name_len) {
-    unsigned long hash = 0;
+    size_t item_ix = 0;
+    if (!object || !name) {
+        return NULL;
+    }
+    if (object->count <= PARSON_OBJECT_SCAN_MAX) {
+        item_ix = json_object_scan(object, name, name_len);
+        return item_ix == OBJECT_INVALID_IX ? NULL : object->values[item_ix];
+    }
+    return json_object_getn_value_hashed(object, name, name_len, hash_string(name, name_len));
+}
+
+static JSON_Value * json_object_getn_value_hashed(const JSON_Object *object, const char *name, size_t name_len, unsigned long hash) {
     parson_bool_t found = PARSON_FALSE;
     size_t cell_ix = 0;
     size_t item_ix = 0;
     if (!object || !name) {
         return NULL;
     }
-    hash = hash_string(name, name_len);
+    if (object->count <= PARSON_OBJECT_SCAN_MAX) {
+        item_ix = json_object_scan(object, name, name_len);
+        return item_ix == OBJECT_INVALID_IX ? NULL : object->values[item_ix];
+    }
     found = PARSON_FALSE;
     cell_ix = json_object_get_cell_ix(object, name, name_len, hash, &found);
     if (!found) {
@@ -667,14 +1123,14 @@ static JSON_Status json_object_remove_internal(JSON_Object *object, const char *
         val = NULL;
     }
 
-    parson_free(object->names[item_ix]);
+    key_release(object->names[item_ix]);
     last_item_ix = object->count - 1;
     if (item_ix < last_item_ix) {
         object->names[item_ix] = object->names[last_item_ix];
         object->values[item_ix] = object->values[last_item_ix];
         object->cell_ixs[item_ix] = object->cell_ixs[last_item_ix];
         object->hashes[item_ix] = object->hashes[last_item_ix];
-        object->cells[object->cell_ixs[item_ix]] = item_ix;
+        json_object_set_cell(object, object->cell_ixs[item_ix], item_ix);
     }
     object->count--;
 
@@ -689,11 +1145,11 @@ static JSON_Status json_object_remove_internal(JSON_Object *object, const char *
         if ((j > i && (k <= i || k > j))
          || (j < i && (k <= i && k > j))) {
             object->cell_ixs[object->cells[j]] = i;
-            object->cells[i] = object->cells[j];
+            json_object_set_cell(object, i, object->cells[j]);
             i = j;
         }
     }
-    object->cells[i] = OBJECT_INVALID_IX;
+    json_object_set_cell(object, i, OBJECT_INVALID_IX);
     return JSONSuccess;
 }
 
@@ -714,12 +1170,12 @@ static JSON_Status json_object_dotremove_internal(JSON_Object *object, const cha
 
 static void json_object_free(JSON_Object *object) {
     json_object_deinit(object, PARSON_TRUE, PARSON_TRUE);
-    parson_free(object);
+    pool_free(POOL_OBJECT, object);
 }
 
 /* JSON Array */
 static JSON_Array * json_array_make(JSON_Value *wrapping_value) {
-    JSON_Array *new_array = (JSON_Array*)parson_malloc(sizeof(JSON_Array));
+    JSON_Array *new_array = (JSON_Array*)pool_malloc(POOL_ARRAY, sizeof(JSON_Array));
     if (new_array == NULL) {
         return NULL;
     }
@@ -748,31 +1204,43 @@ static JSON_Status json_array_resize(JSON_Array *array, size_t new_capacity) {
     if (new_capacity == 0) {
         return JSONFailure;
     }
-    new_items = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
+    if (new_capacity == STARTING_CAPACITY) {
+        new_items = (JSON_Value**)pool_malloc(POOL_ARRAY_ITEMS, new_capacity * sizeof(JSON_Value*));
+    } else {
+        new_items = (JSON_Value**)parson_malloc(new_capacity * sizeof(JSON_Value*));
+    }
     if (new_items == NULL) {
         return JSONFailure;
     }
     if (array->items != NULL && array->count > 0) {
         memcpy(new_items, array->items, array->count * sizeof(JSON_Value*));
     }
-    parson_free(array->items);
+    json_array_free_items(array);
     array->items = new_items;
     array->capacity = new_capacity;
     return JSONSuccess;
 }
 
+static void json_array_free_items(JSON_Array *array) {
+    if (array->capacity == STARTING_CAPACITY) {
+        pool_free(POOL_ARRAY_ITEMS, array->items);
+    } else {
+        parson_free(array->items);
+    }
+}
+
 static void json_array_free(JSON_Array *array) {
     size_t i;
     for (i = 0; i < array->count; i++) {
         json_value_free(array->items[i]);
     }
-    parson_free(array->items);
-    parson_free(array);
+    json_array_free_items(array);
+    pool_free(POOL_ARRAY, array);
 }
 
 /* JSON Value */
 static JSON_Value * json_value_init_string_no_copy(char *string, size_t length) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = (JSON_Value*)pool_malloc(POOL_VALUE, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
@@ -851,18 +1319,11 @@ static JSON_Status parse_utf16(const char **unprocessed, char **processed) {
 }
 
 
-/* Copies and processes passed string up to supplied length.
-Example: "\u006Corem ipsum" -> lorem ipsum */
-static char* process_string(const char *input, size_t input_len, size_t *output_len) {
+/* Unescapes passed string up to supplied length into output, which must hold at least
+   input_len + 1 chars. output may be the same buffer as input (unescaping never grows a string). */
+static JSON_Status unescape_string(const char *input, size_t input_len, char *output, size_t *output_len) {
     const char *input_ptr = input;
-    size_t initial_size = (input_len + 1) * sizeof(char);
-    size_t final_size = 0;
-    char *output = NULL, *output_ptr = NULL, *resized_output = NULL;
-    output = (char*)parson_malloc(initial_size);
-    if (output == NULL) {
-        goto error;
-    }
-    output_ptr = output;
+    char *output_ptr = output;
     while ((*input_ptr != '\0') && (size_t)(input_ptr - input) < input_len) {
         if (*input_ptr == '\\') {
             input_ptr++;
@@ -877,14 +1338,14 @@ static char* process_string(const char *input, size_t input_len, size_t *output_
                 case 't':  *output_ptr = '\t'; break;
                 case 'u':
                     if (parse_utf16(&input_ptr, &output_ptr) != JSONSuccess) {
-                        goto error;
+                        return JSONFailure;
                     }
                     break;
                 default:
-                    goto error;
+                    return JSONFailure;
             }
         } else if ((unsigned char)*input_ptr < 0x20) {
-            goto error; /* 0x00-0x19 are invalid characters for json string (http://www.ietf.org/rfc/rfc4627.txt) */
+            return JSONFailure; /* 0x00-0x19 are invalid characters for json string (http://www.ietf.org/rfc/rfc4627.txt) */
         } else {
             *output_ptr = *input_ptr;
         }
@@ -892,8 +1353,25 @@ static char* process_string(const char *input, size_t input_len, size_t *output_
         input_ptr++;
     }
     *output_ptr = '\0';
+    *output_len = (size_t)(output_ptr - output);
+    return JSONSuccess;
+}
+
+/* Copies and processes passed string up to supplied length.
+Example: "\u006Corem ipsum" -> lorem ipsum */
+static char* process_string(const char *input, size_t input_len, size_t *output_len) {
+    size_t initial_size = (input_len + 1) * sizeof(char);
+    size_t final_size = 0;
+    char *output = NULL, *resized_output = NULL;
+    output = (char*)parson_malloc(initial_size);
+    if (output == NULL) {
+        goto error;
+    }
+    if (unescape_string(input, input_len, output, output_len) != JSONSuccess) {
+        goto error;
+    }
     /* resize to new length */
-    final_size = (size_t)(output_ptr-output) + 1;
+    final_size = *output_len + 1;
     /* todo: don't resize if final_size == initial_size */
     resized_output = (char*)parson_malloc(final_size);
     if (resized_output == NULL) {
@@ -921,16 +1399,57 @@ static char * get_quoted_string(const char **string, size_t *output_string_len)
     return process_string(string_start + 1, input_string_len, output_string_len);
 }
 
-static JSON_Value * parse_value(const char **string, size_t nesting) {
+/* Returns a key for the quoted string at *string. Keys without escapes are
+   looked up straight in the source buffer, so repeated names never get copied. */
+static char * get_object_key(const char **string, JSON_Key_Table *keys) {
+    const char *string_start = *string;
+    const char *chars = NULL;
+    char *processed = NULL, *key = NULL;
+    size_t input_len = 0, key_len = 0, i = 0;
+    if (skip_quotes(string) != JSONSuccess) {
+        return NULL;
+    }
+    chars = string_start + 1;
+    input_len = *string - string_start - 2; /* length without quotes */
+    for (i = 0; i < input_len; i++) {
+        if (chars[i] == '\\' || (unsigned char)chars[i] < 0x20) {
+            break;
+        }
+    }
+    if (i == input_len) {
+        if (keys != NULL) {
+            return key_table_intern(keys, chars, input_len);
+        }
+        return key_make(chars, input_len, hash_string(chars, input_len));
+    }
+    processed = process_string(chars, input_len, &key_len);
+    if (processed == NULL) {
+        return NULL;
+    }
+    /* We do not support key names with embedded \0 chars */
+    if (key_len != strlen(processed)) {
+        parson_free(processed);
+        return NULL;
+    }
+    if (keys != NULL) {
+        key = key_table_intern(keys, processed, key_len);
+    } else {
+        key = key_make(processed, key_len, hash_string(processed, key_len));
+    }
+    parson_free(processed);
+    return key;
+}
+
+static JSON_Value * parse_value(const char **string, size_t nesting, JSON_Key_Table *keys) {
     if (nesting > MAX_NESTING) {
         return NULL;
     }
     SKIP_WHITESPACES(string);
     switch (**string) {
         case '{':
-            return parse_object_value(string, nesting + 1);
+            return parse_object_value(string, nesting + 1, keys);
         case '[':
-            return parse_array_value(string, nesting + 1);
+            return parse_array_value(string, nesting + 1, keys);
         case '\"':
             return parse_string_value(string);
         case 'f': case 't':
@@ -946,7 +1465,7 @@ static JSON_Value * parse_value(const char **string, size_t nesting) {
     }
 }
 
-static JSON_Value * parse_object_value(const char **string, size_t nesting) {
+static JSON_Value * parse_object_value(const char **string, size_t nesting, JSON_Key_Table *keys) {
     JSON_Status status = JSONFailure;
     JSON_Value *output_value = NULL, *new_value = NULL;
     JSON_Object *output_object = NULL;
@@ -968,34 +1487,27 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
         return output_value;
     }
     while (**string != '\0') {
-        size_t key_len = 0;
-        new_key = get_quoted_string(string, &key_len);
-        /* We do not support key names with embedded \0 chars */
+        new_key = get_object_key(string, keys);
         if (!new_key) {
             json_value_free(output_value);
             return NULL;
         }
-        if (key_len != strlen(new_key)) {
-            parson_free(new_key);
-            json_value_free(output_value);
-            return NULL;
-        }
         SKIP_WHITESPACES(string);
         if (**string != ':') {
-            parson_free(new_key);
+            key_release(new_key);
             json_value_free(output_value);
             return NULL;
         }
         SKIP_CHAR(string);
-        new_value = parse_value(string, nesting);
+        new_value = parse_value(string, nesting, keys);
         if (new_value == NULL) {
-            parson_free(new_key);
+            key_release(new_key);
             json_value_free(output_value);
             return NULL;
         }
         status = json_object_add(output_object, new_key, new_value);
         if (status != JSONSuccess) {
-            parson_free(new_key);
+            key_release(new_key);
             json_value_free(new_value);
             json_value_free(output_value);
             return NULL;
@@ -1019,7 +1531,7 @@ static JSON_Value * parse_object_value(const char **string, size_t nesting) {
     return output_value;
 }
 
-static JSON_Value * parse_array_value(const char **string, size_t nesting) {
+static JSON_Value * parse_array_value(const char **string, size_t nesting, JSON_Key_Table *keys) {
     JSON_Value *output_value = NULL, *new_array_value = NULL;
     JSON_Array *output_array = NULL;
     output_value = json_value_init_array();
@@ -1038,7 +1550,7 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
         return output_value;
     }
     while (**string != '\0') {
-        new_array_value = parse_value(string, nesting);
+        new_array_value = parse_value(string, nesting, keys);
         if (new_array_value == NULL) {
             json_value_free(output_value);
             return NULL;
@@ -1059,8 +1571,9 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
         }
     }
     SKIP_WHITESPACES(string);
-    if (**string != ']' || /* Trim array after parsing is over */
-        json_array_resize(output_array, json_array_get_count(output_array)) != JSONSuccess) {
+    if (**string != ']' || /* Trim array after parsing is over, small arrays keep their recyclable size */
+        (output_array->capacity > STARTING_CAPACITY
+         && json_array_resize(output_array, json_array_get_count(output_array)) != JSONSuccess)) {
             json_value_free(output_value);
             return NULL;
     }
@@ -1068,6 +1581,20 @@ static JSON_Value * parse_array_value(const char **string, size_t nesting) {
     return output_value;
 }
 
+static JSON_Value * parse_root_value(const char **string, size_t nesting) {
+    JSON_Key_Table keys;
+    JSON_Value *result = NULL;
+    if (!parson_key_interning) {
+        return parse_value(string, nesting, NULL);
+    }
+    keys.keys = NULL;
+    keys.count = 0;
+    keys.capacity = 0;
+    result = parse_value(string, nesting, &keys);
+    key_table_deinit(&keys);
+    return result;
+}
+
 static JSON_Value * parse_string_value(const char **string) {
     JSON_Value *value = NULL;
     size_t new_string_len = 0;
@@ -1093,29 +1620,471 @@ static JSON_Value * parse_boolean_value(const char **string) {
         *string += false_token_size;
         return json_value_init_boolean(0);
     }
-    return NULL;
+    return NULL;
+}
+
+static JSON_Value * parse_number_value(const char **string) {
+    char *end;
+    double number = 0;
+    errno = 0;
+    number = strtod(*string, &end);
+    if (errno == ERANGE && (number <= -HUGE_VAL || number >= HUGE_VAL)) {
+        return NULL;
+    }
+    if ((errno && errno != ERANGE) || !is_decimal(*string, end - *string)) {
+        return NULL;
+    }
+    *string = end;
+    return json_value_init_number(number);
+}
+
+static JSON_Value * parse_null_value(const char **string) {
+    size_t token_size = SIZEOF_TOKEN("null");
+    if (strncmp("null", *string, token_size) == 0) {
+        *string += token_size;
+        return json_value_init_null();
+    }
+    return NULL;
+}
+
+/* Moves past a value without decoding it. Only the structure is checked
+   (matching brackets outside of strings), contents are validated when the
+   value is actually parsed. */
+static JSON_Status skip_value(const char **string) {
+    size_t depth = 0;
+    SKIP_WHITESPACES(string);
+    switch (**string) {
+        case '\"':
+            return skip_quotes(string);
+        case '{': case '[':
+            while (**string != '\0') {
+                switch (**string) {
+                    case '\"':
+                        if (skip_quotes(string) != JSONSuccess) {
+                            return JSONFailure;
+                        }
+                        continue;
+                    case '{': case '[':
+                        depth++;
+                        if (depth > MAX_NESTING) {
+                            return JSONFailure;
+                        }
+                        break;
+                    case '}': case ']':
+                        depth--;
+                        if (depth == 0) {
+                            SKIP_CHAR(string);
+                            return JSONSuccess;
+                        }
+                        break;
+                    default:
+                        break;
+                }
+                SKIP_CHAR(string);
+            }
+            return JSONFailure;
+        default:
+            if (**string == '\0' || strchr(",:}]", **string)) {
+                return JSONFailure;
+            }
+            while (**string != '\0' && !strchr(",:}]", **string) && !isspace((unsigned char)**string)) {
+                SKIP_CHAR(string);
+            }
+            return JSONSuccess;
+    }
+}
+
+#ifdef PARSON_ENABLE_THREADS
+/* Splits the array at string into at most `parts` runs of elements of similar
+   size. bounds[0] points past the opening bracket, bounds[1..n-1] at the
+   separating commas and bounds[n] at the closing bracket. Returns n, or 0 if
+   the array isn't closed. */
+static size_t split_array(const char *string, size_t length, const char **bounds, size_t parts) {
+    const char *p = string + 1;
+    size_t depth = 1, count = 1, step = length / parts;
+    bounds[0] = p;
+    while (*p != '\0') {
+        switch (*p) {
+            case '\"':
+                for (p++; *p != '\"'; p++) {
+                    if (*p == '\\') {
+                        p++;
+                    }
+                    if (*p == '\0') {
+                        return 0;
+                    }
+                }
+                break;
+            case '{': case '[':
+                depth++;
+                break;
+            case '}': case ']':
+                depth--;
+                if (depth == 0) {
+                    bounds[count] = p;
+                    return *p == ']' ? count : 0;
+                }
+                break;
+            case ',':
+                if (depth == 1 && count < parts && (size_t)(p - string) >= count * step) {
+                    bounds[count++] = p;
+                }
+                break;
+            default:
+                break;
+        }
+        p++;
+    }
+    return 0;
+}
+
+/* Parses the elements between string and end into a new array */
+static JSON_Value * parse_array_chunk(const char *string, const char *end) {
+    JSON_Key_Table keys;
+    JSON_Value *output_value = NULL, *new_array_value = NULL;
+    JSON_Array *output_array = NULL;
+    parson_bool_t failed = PARSON_FALSE;
+    output_value = json_value_init_array();
+    if (output_value == NULL) {
+        return NULL;
+    }
+    output_array = json_value_get_array(output_value);
+    keys.keys = NULL;
+    keys.count = 0;
+    keys.capacity = 0;
+    while (!failed) { /* every chunk holds at least one element */
+        new_array_value = parse_value(&string, 1, parson_key_interning ? &keys : NULL);
+        if (new_array_value == NULL) {
+            failed = PARSON_TRUE;
+            break;
+        }
+        if (json_array_add(output_array, new_array_value) != JSONSuccess) {
+            json_value_free(new_array_value);
+            failed = PARSON_TRUE;
+            break;
+        }
+        SKIP_WHITESPACES(&string);
+        if (string >= end || *string != ',') {
+            break;
+        }
+        SKIP_CHAR(&string);
+        SKIP_WHITESPACES(&string);
+        if (string >= end) { /* trailing comma, only allowed before the closing bracket */
+            failed = *end != ']';
+            break;
+        }
+    }
+    key_table_deinit(&keys);
+    if (failed || string != end) {
+        json_value_free(output_value);
+        return NULL;
+    }
+    return output_value;
+}
+
+static void * parse_array_chunk_thread(void *chunk) {
+    JSON_Array_Chunk *array_chunk = (JSON_Array_Chunk*)chunk;
+    array_chunk->result = parse_array_chunk(array_chunk->start, array_chunk->end);
+    json_release_pooled_memory();
+    return NULL;
+}
+
+/* Moves the elements of all chunks into one array and frees the chunks.
+   Returns NULL if any chunk failed to parse. */
+static JSON_Value * join_array_chunks(JSON_Array_Chunk *chunks, size_t count) {
+    JSON_Value *output_value = NULL;
+    JSON_Array *output_array = NULL, *chunk_array = NULL;
+    size_t i = 0, j = 0, total = 0;
+    parson_bool_t failed = PARSON_FALSE;
+    for (i = 0; i < count; i++) {
+        if (chunks[i].result == NULL) {
+            failed = PARSON_TRUE;
+        } else {
+            total += json_array_get_count(json_value_get_array(chunks[i].result));
+        }
+    }
+    if (!failed) {
+        output_value = json_value_init_array();
+        failed = output_value == NULL;
+    }
+    if (!failed && total > 0) {
+        output_array = json_value_get_array(output_value);
+        failed = json_array_resize(output_array, total) != JSONSuccess;
+    }
+    for (i = 0; i < count; i++) {
+        if (chunks[i].result == NULL) {
+            continue;
+        }
+        chunk_array = json_value_get_array(chunks[i].result);
+        if (!failed) {
+            for (j = 0; j < chunk_array->count; j++) {
+                chunk_array->items[j]->parent = output_value;
+                output_array->items[output_array->count++] = chunk_array->items[j];
+            }
+            chunk_array->count = 0;
+        }
+        json_value_free(chunks[i].result);
+    }
+    if (failed) {
+        if (output_value != NULL) {
+            json_value_free(output_value);
+        }
+        return NULL;
+    }
+    return output_value;
+}
+#endif /* PARSON_ENABLE_THREADS */
+
+/* JSON Tape */
+static JSON_Status tape_push_value(JSON_Tape_Parser *parser, JSON_Value_Type type) {
+    JSON_Tape_Value *new_values = NULL;
+    size_t new_capacity = 0;
+    if (parser->values_count >= parser->values_capacity) {
+        new_capacity = MAX(parser->values_capacity * 2, STARTING_CAPACITY);
+        new_values = (JSON_Tape_Value*)parson_malloc(new_capacity * sizeof(JSON_Tape_Value));
+        if (new_values == NULL) {
+            return JSONFailure;
+        }
+        if (parser->values != NULL) {
+            memcpy(new_values, parser->values, parser->values_count * sizeof(JSON_Tape_Value));
+        }
+        parson_free(parser->values);
+        parser->values = new_values;
+        parser->values_capacity = new_capacity;
+    }
+    parser->values[parser->values_count].type = type;
+    parser->values[parser->values_count].length = 0;
+    parser->values[parser->values_count].as.string = NULL;
+    parser->values_count++;
+    return JSONSuccess;
+}
+
+static JSON_Status tape_push_item(JSON_Tape_Parser *parser, size_t value_ix) {
+    size_t *new_pending = NULL;
+    size_t new_capacity = 0;
+    if (parser->pending_count >= parser->pending_capacity) {
+        new_capacity = MAX(parser->pending_capacity * 2, STARTING_CAPACITY);
+        new_pending = (size_t*)parson_malloc(new_capacity * sizeof(size_t));
+        if (new_pending == NULL) {
+            return JSONFailure;
+        }
+        if (parser->pending != NULL) {
+            memcpy(new_pending, parser->pending, parser->pending_count * sizeof(size_t));
+        }
+        parson_free(parser->pending);
+        parser->pending = new_pending;
+        parser->pending_capacity = new_capacity;
+    }
+    parser->pending[parser->pending_count] = value_ix;
+    parser->pending_count++;
+    return JSONSuccess;
+}
+
+/* Moves items collected since items_start from the pending stack to the index,
+   so every container's items end up contiguous. */
+static JSON_Status tape_close_container(JSON_Tape_Parser *parser, size_t container_ix, size_t items_start) {
+    size_t count = parser->pending_count - items_start;
+    size_t needed = parser->items_count + count;
+    size_t new_capacity = 0, i = 0;
+    unsigned int *new_items = NULL;
+    if (count > TAPE_MAX_LENGTH || parser->values_count > TAPE_MAX_LENGTH) {
+        return JSONFailure;
+    }
+    if (needed > parser->items_capacity) {
+        new_capacity = MAX(parser->items_capacity * 2, MAX(needed, STARTING_CAPACITY));
+        new_items = (unsigned int*)parson_malloc(new_capacity * sizeof(unsigned int));
+        if (new_items == NULL) {
+            return JSONFailure;
+        }
+        if (parser->items != NULL) {
+            memcpy(new_items, parser->items, parser->items_count * sizeof(unsigned int));
+        }
+        parson_free(parser->items);
+        parser->items = new_items;
+        parser->items_capacity = new_capacity;
+    }
+    for (i = 0; i < count; i++) {
+        parser->items[parser->items_count + i] = (unsigned int)(parser->pending[items_start + i] - container_ix);
+    }
+    parser->values[container_ix].length = (unsigned int)count;
+    parser->values[container_ix].as.items_ix = parser->items_count;
+    parser->items_count += count;
+    parser->pending_count = items_start;
+    return JSONSuccess;
+}
+
+static JSON_Status tape_parse_string(JSON_Tape_Parser *parser, char **string) {
+    char *string_start = *string;
+    size_t input_len = 0, output_len = 0;
+    JSON_Tape_Value *value = NULL;
+    if (skip_quotes((const char**)string) != JSONSuccess) {
+        return JSONFailure;
+    }
+    input_len = *string - string_start - 2; /* length without quotes */
+    if (unescape_string(string_start + 1, input_len, string_start + 1, &output_len) != JSONSuccess
+        || output_len > TAPE_MAX_LENGTH
+        || tape_push_value(parser, JSONString) != JSONSuccess) {
+        return JSONFailure;
+    }
+    value = &parser->values[parser->values_count - 1];
+    value->length = (unsigned int)output_len;
+    value->as.string = string_start + 1;
+    return JSONSuccess;
+}
+
+static JSON_Status tape_parse_object(JSON_Tape_Parser *parser, char **string, size_t nesting) {
+    size_t object_ix = parser->values_count;
+    size_t items_start = parser->pending_count;
+    if (tape_push_value(parser, JSONObject) != JSONSuccess) {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    SKIP_WHITESPACES(string);
+    if (**string == '}') { /* empty object */
+        SKIP_CHAR(string);
+        return tape_close_container(parser, object_ix, items_start);
+    }
+    while (**string != '\0') {
+        if (tape_push_item(parser, parser->values_count) != JSONSuccess
+            || tape_parse_string(parser, string) != JSONSuccess) {
+            return JSONFailure;
+        }
+        /* We do not support key names with embedded \0 chars */
+        if (strlen(parser->values[parser->values_count - 1].as.string) != parser->values[parser->values_count - 1].length) {
+            return JSONFailure;
+        }
+        SKIP_WHITESPACES(string);
+        if (**string != ':') {
+            return JSONFailure;
+        }
+        SKIP_CHAR(string);
+        if (tape_parse_value(parser, string, nesting) != JSONSuccess) {
+            return JSONFailure;
+        }
+        SKIP_WHITESPACES(string);
+        if (**string != ',') {
+            break;
+        }
+        SKIP_CHAR(string);
+        SKIP_WHITESPACES(string);
+        if (**string == '}') {
+            break;
+        }
+    }
+    SKIP_WHITESPACES(string);
+    if (**string != '}') {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    return tape_close_container(parser, object_ix, items_start);
+}
+
+static JSON_Status tape_parse_array(JSON_Tape_Parser *parser, char **string, size_t nesting) {
+    size_t array_ix = parser->values_count;
+    size_t items_start = parser->pending_count;
+    if (tape_push_value(parser, JSONArray) != JSONSuccess) {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    SKIP_WHITESPACES(string);
+    if (**string == ']') { /* empty array */
+        SKIP_CHAR(string);
+        return tape_close_container(parser, array_ix, items_start);
+    }
+    while (**string != '\0') {
+        if (tape_push_item(parser, parser->values_count) != JSONSuccess
+            || tape_parse_value(parser, string, nesting) != JSONSuccess) {
+            return JSONFailure;
+        }
+        SKIP_WHITESPACES(string);
+        if (**string != ',') {
+            break;
+        }
+        SKIP_CHAR(string);
+        SKIP_WHITESPACES(string);
+        if (**string == ']') {
+            break;
+        }
+    }
+    SKIP_WHITESPACES(string);
+    if (**string != ']') {
+        return JSONFailure;
+    }
+    SKIP_CHAR(string);
+    return tape_close_container(parser, array_ix, items_start);
+}
+
+static JSON_Status tape_parse_value(JSON_Tape_Parser *parser, char **string, size_t nesting) {
+    const char *number_start = NULL;
+    char *end = NULL;
+    double number = 0;
+    int boolean = 0;
+    if (nesting > MAX_NESTING) {
+        return JSONFailure;
+    }
+    SKIP_WHITESPACES(string);
+    switch (**string) {
+        case '{':
+            return tape_parse_object(parser, string, nesting + 1);
+        case '[':
+            return tape_parse_array(parser, string, nesting + 1);
+        case '\"':
+            return tape_parse_string(parser, string);
+        case 'f': case 't':
+            if (strncmp("true", *string, SIZEOF_TOKEN("true")) == 0) {
+                *string += SIZEOF_TOKEN("true");
+                boolean = 1;
+            } else if (strncmp("false", *string, SIZEOF_TOKEN("false")) == 0) {
+                *string += SIZEOF_TOKEN("false");
+                boolean = 0;
+            } else {
+                return JSONFailure;
+            }
+            if (tape_push_value(parser, JSONBoolean) != JSONSuccess) {
+                return JSONFailure;
+            }
+            parser->values[parser->values_count - 1].as.boolean = boolean;
+            return JSONSuccess;
+        case '-':
+        case '0': case '1': case '2': case '3': case '4':
+        case '5': case '6': case '7': case '8': case '9':
+            number_start = *string;
+            errno = 0;
+            number = strtod(number_start, &end);
+            if (errno == ERANGE && (number <= -HUGE_VAL || number >= HUGE_VAL)) {
+                return JSONFailure;
+            }
+            if ((errno && errno != ERANGE) || !is_decimal(number_start, end - number_start)
+                || tape_push_value(parser, JSONNumber) != JSONSuccess) {
+                return JSONFailure;
+            }
+            parser->values[parser->values_count - 1].as.number = number;
+            *string = end;
+            return JSONSuccess;
+        case 'n':
+            if (strncmp("null", *string, SIZEOF_TOKEN("null")) != 0) {
+                return JSONFailure;
+            }
+            *string += SIZEOF_TOKEN("null");
+            return tape_push_value(parser, JSONNull);
+        default:
+            return JSONFailure;
+    }
 }
 
-static JSON_Value * parse_number_value(const char **string) {
-    char *end;
-    double number = 0;
-    errno = 0;
-    number = strtod(*string, &end);
-    if (errno == ERANGE && (number <= -HUGE_VAL || number >= HUGE_VAL)) {
-        return NULL;
-    }
-    if ((errno && errno != ERANGE) || !is_decimal(*string, end - *string)) {
+static const JSON_Tape_Value * tape_object_find(const JSON_Tape_Value *object, const char *name) {
+    const JSON_Tape_Value *key = NULL;
+    size_t name_len = 0;
+    unsigned int i = 0;
+    if (object == NULL || object->type != JSONObject || name == NULL) {
         return NULL;
     }
-    *string = end;
-    return json_value_init_number(number);
-}
-
-static JSON_Value * parse_null_value(const char **string) {
-    size_t token_size = SIZEOF_TOKEN("null");
-    if (strncmp("null", *string, token_size) == 0) {
-        *string += token_size;
-        return json_value_init_null();
+    name_len = strlen(name);
+    for (i = 0; i < object->length; i++) {
+        key = object + object->as.items[i];
+        if (key->length == name_len && memcmp(key->as.string, name, name_len) == 0) {
+            return key + 1;
+        }
     }
     return NULL;
 }
@@ -1387,7 +2356,7 @@ JSON_Value * json_parse_string(const char *string) {
     if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
         string = string + 3; /* Support for UTF-8 BOM */
     }
-    return parse_value((const char**)&string, 0);
+    return parse_root_value((const char**)&string, 0);
 }
 
 JSON_Value * json_parse_string_with_comments(const char *string) {
@@ -1400,11 +2369,408 @@ JSON_Value * json_parse_string_with_comments(const char *string) {
     remove_comments(string_mutable_copy, "/*", "*/");
     remove_comments(string_mutable_copy, "//", "\n");
     string_mutable_copy_ptr = string_mutable_copy;
-    result = parse_value((const char**)&string_mutable_copy_ptr, 0);
+    result = parse_root_value((const char**)&string_mutable_copy_ptr, 0);
     parson_free(string_mutable_copy);
     return result;
 }
 
+JSON_Value * json_parse_string_parallel(const char *string, unsigned int threads) {
+#ifdef PARSON_ENABLE_THREADS
+    JSON_Array_Chunk chunks[PARSON_PARALLEL_MAX_THREADS];
+    pthread_t workers[PARSON_PARALLEL_MAX_THREADS];
+    parson_bool_t started[PARSON_PARALLEL_MAX_THREADS];
+    const char *bounds[PARSON_PARALLEL_MAX_THREADS + 1];
+    const char *array = string;
+    JSON_Value *result = NULL;
+    size_t parts = 0, length = 0, i = 0;
+    if (string == NULL) {
+        return NULL;
+    }
+    if (array[0] == '\xEF' && array[1] == '\xBB' && array[2] == '\xBF') {
+        array = array + 3; /* Support for UTF-8 BOM */
+    }
+    SKIP_WHITESPACES(&array);
+    if (*array != '[') {
+        return json_parse_string(string);
+    }
+    parts = MIN(threads, PARSON_PARALLEL_MAX_THREADS);
+    length = strlen(array);
+    parts = MIN(parts, length / PARSON_PARALLEL_MIN_CHUNK);
+    if (parts > 1) {
+        parts = split_array(array, length, bounds, parts);
+    }
+    if (parts < 2) { /* also unclosed arrays, the serial parser reports those */
+        return json_parse_string(string);
+    }
+    for (i = 0; i < parts; i++) {
+        chunks[i].start = i == 0 ? bounds[0] : bounds[i] + 1;
+        chunks[i].end = bounds[i + 1];
+        chunks[i].result = NULL;
+        started[i] = i > 0 && pthread_create(&workers[i], NULL, parse_array_chunk_thread, &chunks[i]) == 0;
+    }
+    for (i = 0; i < parts; i++) {
+        if (started[i]) {
+            pthread_join(workers[i], NULL);
+        } else {
+            chunks[i].result = parse_array_chunk(chunks[i].start, chunks[i].end);
+        }
+    }
+    result = join_array_chunks(chunks, parts);
+    if (result == NULL) { /* malformed input or out of memory, let the serial parser decide */
+        return json_parse_string(string);
+    }
+    return result;
+#else
+    (void)threads;
+    return json_parse_string(string);
+#endif
+}
+
+/* JSON Lazy API */
+static JSON_Status lazy_add_member(JSON_Lazy *lazy, const char *name, size_t name_len, const char *start) {
+    JSON_Lazy_Member *new_members = NULL;
+    size_t new_capacity = 0;
+    if (lazy->count >= lazy->capacity) {
+        new_capacity = MAX(lazy->capacity * 2, STARTING_CAPACITY);
+        new_members = (JSON_Lazy_Member*)parson_malloc(new_capacity * sizeof(JSON_Lazy_Member));
+        if (new_members == NULL) {
+            return JSONFailure;
+        }
+        if (lazy->members != NULL) {
+            memcpy(new_members, lazy->members, lazy->count * sizeof(JSON_Lazy_Member));
+        }
+        parson_free(lazy->members);
+        lazy->members = new_members;
+        lazy->capacity = new_capacity;
+    }
+    lazy->members[lazy->count].name = name;
+    lazy->members[lazy->count].name_len = name_len;
+    lazy->members[lazy->count].start = start;
+    lazy->members[lazy->count].value = NULL;
+    lazy->count++;
+    return JSONSuccess;
+}
+
+static JSON_Status lazy_index(JSON_Lazy *lazy, char *string) {
+    char closing = *string == '{' ? '}' : ']';
+    char *key = NULL;
+    size_t key_len = 0;
+    SKIP_CHAR(&string);
+    SKIP_WHITESPACES(&string);
+    if (*string == closing) {
+        return JSONSuccess;
+    }
+    while (*string != '\0') {
+        if (lazy->type == JSONObject) {
+            key = string;
+            if (skip_quotes((const char**)&string) != JSONSuccess
+                || unescape_string(key + 1, string - key - 2, key + 1, &key_len) != JSONSuccess
+                || key_len != strlen(key + 1)) { /* We do not support key names with embedded \0 chars */
+                return JSONFailure;
+            }
+            SKIP_WHITESPACES(&string);
+            if (*string != ':') {
+                return JSONFailure;
+            }
+            SKIP_CHAR(&string);
+            SKIP_WHITESPACES(&string);
+            if (lazy_add_member(lazy, key + 1, key_len, string) != JSONSuccess) {
+                return JSONFailure;
+            }
+        } else {
+            SKIP_WHITESPACES(&string);
+            if (lazy_add_member(lazy, NULL, 0, string) != JSONSuccess) {
+                return JSONFailure;
+            }
+        }
+        if (skip_value((const char**)&string) != JSONSuccess) {
+            return JSONFailure;
+        }
+        SKIP_WHITESPACES(&string);
+        if (*string != ',') {
+            break;
+        }
+        SKIP_CHAR(&string);
+        SKIP_WHITESPACES(&string);
+        if (*string == closing) {
+            break;
+        }
+    }
+    SKIP_WHITESPACES(&string);
+    return *string == closing ? JSONSuccess : JSONFailure;
+}
+
+static JSON_Value * lazy_materialize(JSON_Lazy_Member *member) {
+    const char *string = member->start;
+    if (member->value == NULL) {
+        member->value = parse_root_value(&string, 1);
+    }
+    return member->value;
+}
+
+JSON_Lazy * json_lazy_parse_string(const char *string) {
+    JSON_Lazy *lazy = NULL;
+    char *start = NULL;
+    if (string == NULL) {
+        return NULL;
+    }
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    lazy = (JSON_Lazy*)parson_malloc(sizeof(JSON_Lazy));
+    if (lazy == NULL) {
+        return NULL;
+    }
+    memset(lazy, 0, sizeof(JSON_Lazy));
+    lazy->buffer = parson_strdup(string);
+    if (lazy->buffer == NULL) {
+        goto error;
+    }
+    start = lazy->buffer;
+    SKIP_WHITESPACES(&start);
+    if (*start == '{') {
+        lazy->type = JSONObject;
+    } else if (*start == '[') {
+        lazy->type = JSONArray;
+    } else {
+        goto error;
+    }
+    if (lazy_index(lazy, start) != JSONSuccess) {
+        goto error;
+    }
+    return lazy;
+error:
+    json_lazy_free(lazy);
+    return NULL;
+}
+
+void json_lazy_free(JSON_Lazy *lazy) {
+    size_t i = 0;
+    if (lazy == NULL) {
+        return;
+    }
+    for (i = 0; i < lazy->count; i++) {
+        if (lazy->members[i].value != NULL) {
+            json_value_free(lazy->members[i].value);
+        }
+    }
+    parson_free(lazy->members);
+    parson_free(lazy->buffer);
+    parson_free(lazy);
+}
+
+JSON_Value_Type json_lazy_get_type(const JSON_Lazy *lazy) {
+    return lazy ? lazy->type : JSONError;
+}
+
+size_t json_lazy_get_count(const JSON_Lazy *lazy) {
+    return lazy ? lazy->count : 0;
+}
+
+JSON_Value * json_lazy_object_get_value(JSON_Lazy *lazy, const char *name) {
+    size_t i = 0, name_len = 0;
+    if (json_lazy_get_type(lazy) != JSONObject || name == NULL) {
+        return NULL;
+    }
+    name_len = strlen(name);
+    for (i = 0; i < lazy->count; i++) {
+        if (lazy->members[i].name_len == name_len && memcmp(lazy->members[i].name, name, name_len) == 0) {
+            return lazy_materialize(&lazy->members[i]);
+        }
+    }
+    return NULL;
+}
+
+const char * json_lazy_object_get_string(JSON_Lazy *lazy, const char *name) {
+    return json_value_get_string(json_lazy_object_get_value(lazy, name));
+}
+
+double json_lazy_object_get_number(JSON_Lazy *lazy, const char *name) {
+    return json_value_get_number(json_lazy_object_get_value(lazy, name));
+}
+
+JSON_Object * json_lazy_object_get_object(JSON_Lazy *lazy, const char *name) {
+    return json_value_get_object(json_lazy_object_get_value(lazy, name));
+}
+
+JSON_Array * json_lazy_object_get_array(JSON_Lazy *lazy, const char *name) {
+    return json_value_get_array(json_lazy_object_get_value(lazy, name));
+}
+
+const char * json_lazy_object_get_name(const JSON_Lazy *lazy, size_t index) {
+    if (json_lazy_get_type(lazy) != JSONObject || index >= lazy->count) {
+        return NULL;
+    }
+    return lazy->members[index].name;
+}
+
+JSON_Value * json_lazy_get_value_at(JSON_Lazy *lazy, size_t index) {
+    if (lazy == NULL || index >= lazy->count) {
+        return NULL;
+    }
+    return lazy_materialize(&lazy->members[index]);
+}
+
+JSON_Object * json_lazy_array_get_object(JSON_Lazy *lazy, size_t index) {
+    if (json_lazy_get_type(lazy) != JSONArray) {
+        return NULL;
+    }
+    return json_value_get_object(json_lazy_get_value_at(lazy, index));
+}
+
+/* JSON Tape API */
+JSON_Tape * json_tape_parse_string(const char *string) {
+    JSON_Tape_Parser parser;
+    JSON_Tape *tape = NULL;
+    char *buffer = NULL, *buffer_ptr = NULL;
+    size_t i = 0;
+    if (string == NULL) {
+        return NULL;
+    }
+    if (string[0] == '\xEF' && string[1] == '\xBB' && string[2] == '\xBF') {
+        string = string + 3; /* Support for UTF-8 BOM */
+    }
+    memset(&parser, 0, sizeof(parser));
+    buffer = parson_strdup(string);
+    tape = (JSON_Tape*)parson_malloc(sizeof(JSON_Tape));
+    if (buffer == NULL || tape == NULL) {
+        goto error;
+    }
+    buffer_ptr = buffer;
+    if (tape_parse_value(&parser, &buffer_ptr, 0) != JSONSuccess) {
+        goto error;
+    }
+    /* the index doesn't move anymore, so positions can become pointers */
+    for (i = 0; i < parser.values_count; i++) {
+        if (parser.values[i].type == JSONObject || parser.values[i].type == JSONArray) {
+            parser.values[i].as.items = parser.items + parser.values[i].as.items_ix;
+        }
+    }
+    parson_free(parser.pending);
+    tape->buffer = buffer;
+    tape->values = parser.values;
+    tape->items = parser.items;
+    return tape;
+error:
+    parson_free(parser.values);
+    parson_free(parser.items);
+    parson_free(parser.pending);
+    parson_free(buffer);
+    parson_free(tape);
+    return NULL;
+}
+
+void json_tape_free(JSON_Tape *tape) {
+    if (tape == NULL) {
+        return;
+    }
+    parson_free(tape->buffer);
+    parson_free(tape->values);
+    parson_free(tape->items);
+    parson_free(tape);
+}
+
+const JSON_Tape_Value * json_tape_get_root(const JSON_Tape *tape) {
+    return tape ? tape->values : NULL;
+}
+
+JSON_Value_Type json_tape_value_get_type(const JSON_Tape_Value *value) {
+    return value ? value->type : JSONError;
+}
+
+const char * json_tape_value_get_string(const JSON_Tape_Value *value) {
+    return json_tape_value_get_type(value) == JSONString ? value->as.string : NULL;
+}
+
+size_t json_tape_value_get_string_len(const JSON_Tape_Value *value) {
+    return json_tape_value_get_type(value) == JSONString ? value->length : 0;
+}
+
+double json_tape_value_get_number(const JSON_Tape_Value *value) {
+    return json_tape_value_get_type(value) == JSONNumber ? value->as.number : 0;
+}
+
+int json_tape_value_get_boolean(const JSON_Tape_Value *value) {
+    return json_tape_value_get_type(value) == JSONBoolean ? value->as.boolean : -1;
+}
+
+const JSON_Tape_Value * json_tape_object_get_value(const JSON_Tape_Value *object, const char *name) {
+    return tape_object_find(object, name);
+}
+
+const char * json_tape_object_get_string(const JSON_Tape_Value *object, const char *name) {
+    return json_tape_value_get_string(tape_object_find(object, name));
+}
+
+size_t json_tape_object_get_string_len(const JSON_Tape_Value *object, const char *name) {
+    return json_tape_value_get_string_len(tape_object_find(object, name));
+}
+
+double json_tape_object_get_number(const JSON_Tape_Value *object, const char *name) {
+    return json_tape_value_get_number(tape_object_find(object, name));
+}
+
+const JSON_Tape_Value * json_tape_object_get_object(const JSON_Tape_Value *object, const char *name) {
+    const JSON_Tape_Value *value = tape_object_find(object, name);
+    return json_tape_value_get_type(value) == JSONObject ? value : NULL;
+}
+
+const JSON_Tape_Value * json_tape_object_get_array(const JSON_Tape_Value *object, const char *name) {
+    const JSON_Tape_Value *value = tape_object_find(object, name);
+    return json_tape_value_get_type(value) == JSONArray ? value : NULL;
+}
+
+int json_tape_object_get_boolean(const JSON_Tape_Value *object, const char *name) {
+    return json_tape_value_get_boolean(tape_object_find(object, name));
+}
+
+size_t json_tape_object_get_count(const JSON_Tape_Value *object) {
+    return json_tape_value_get_type(object) == JSONObject ? object->length : 0;
+}
+
+const char * json_tape_object_get_name(const JSON_Tape_Value *object, size_t index) {
+    if (index >= json_tape_object_get_count(object)) {
+        return NULL;
+    }
+    return object[object->as.items[index]].as.string;
+}
+
+const JSON_Tape_Value * json_tape_object_get_value_at(const JSON_Tape_Value *object, size_t index) {
+    if (index >= json_tape_object_get_count(object)) {
+        return NULL;
+    }
+    return object + object->as.items[index] + 1;
+}
+
+const JSON_Tape_Value * json_tape_array_get_value(const JSON_Tape_Value *array, size_t index) {
+    if (index >= json_tape_array_get_count(array)) {
+        return NULL;
+    }
+    return array + array->as.items[index];
+}
+
+const char * json_tape_array_get_string(const JSON_Tape_Value *array, size_t index) {
+    return json_tape_value_get_string(json_tape_array_get_value(array, index));
+}
+
+double json_tape_array_get_number(const JSON_Tape_Value *array, size_t index) {
+    return json_tape_value_get_number(json_tape_array_get_value(array, index));
+}
+
+const JSON_Tape_Value * json_tape_array_get_object(const JSON_Tape_Value *array, size_t index) {
+    const JSON_Tape_Value *value = json_tape_array_get_value(array, index);
+    return json_tape_value_get_type(value) == JSONObject ? value : NULL;
+}
+
+const JSON_Tape_Value * json_tape_array_get_array(const JSON_Tape_Value *array, size_t index) {
+    const JSON_Tape_Value *value = json_tape_array_get_value(array, index);
+    return json_tape_value_get_type(value) == JSONArray ? value : NULL;
+}
+
+size_t json_tape_array_get_count(const JSON_Tape_Value *array) {
+    return json_tape_value_get_type(array) == JSONArray ? array->length : 0;
+}
+
 /* JSON Object API */
 
 JSON_Value * json_object_get_value(const JSON_Object *object, const char *name) {
@@ -1471,6 +2837,89 @@ int json_object_dotget_boolean(const JSON_Object *object, const char *name) {
     return json_value_get_boolean(json_object_dotget_value(object, name));
 }
 
+JSON_Path * json_path_compile(const char *name) {
+    JSON_Path *path = NULL;
+    const char *segment_start = NULL, *dot_pos = NULL;
+    size_t i = 0;
+    if (name == NULL) {
+        return NULL;
+    }
+    path = (JSON_Path*)parson_malloc(sizeof(JSON_Path));
+    if (path == NULL) {
+        return NULL;
+    }
+    path->count = 1;
+    for (dot_pos = strchr(name, '.'); dot_pos != NULL; dot_pos = strchr(dot_pos + 1, '.')) {
+        path->count++;
+    }
+    path->names = parson_strdup(name);
+    path->segments = (JSON_Path_Segment*)parson_malloc(path->count * sizeof(JSON_Path_Segment));
+    if (path->names == NULL || path->segments == NULL) {
+        json_path_free(path);
+        return NULL;
+    }
+    segment_start = path->names;
+    for (i = 0; i < path->count; i++) {
+        dot_pos = strchr(segment_start, '.');
+        path->segments[i].name = segment_start;
+        path->segments[i].length = dot_pos ? (size_t)(dot_pos - segment_start) : strlen(segment_start);
+        path->segments[i].hash = hash_string(segment_start, path->segments[i].length);
+        segment_start += path->segments[i].length + 1;
+    }
+    return path;
+}
+
+void json_path_free(JSON_Path *path) {
+    if (path == NULL) {
+        return;
+    }
+    parson_free(path->names);
+    parson_free(path->segments);
+    parson_free(path);
+}
+
+JSON_Value * json_object_path_get_value(const JSON_Object *object, const JSON_Path *path) {
+    JSON_Value *value = NULL;
+    const JSON_Path_Segment *segment = NULL;
+    size_t i = 0;
+    if (object == NULL || path == NULL) {
+        return NULL;
+    }
+    for (i = 0; i < path->count; i++) {
+        segment = &path->segments[i];
+        value = json_object_getn_value_hashed(object, segment->name, segment->length, segment->hash);
+        object = json_value_get_object(value);
+        if (object == NULL && i + 1 < path->count) {
+            return NULL;
+        }
+    }
+    return value;
+}
+
+const char * json_object_path_get_string(const JSON_Object *object, const JSON_Path *path) {
+    return json_value_get_string(json_object_path_get_value(object, path));
+}
+
+size_t json_object_path_get_string_len(const JSON_Object *object, const JSON_Path *path) {
+    return json_value_get_string_len(json_object_path_get_value(object, path));
+}
+
+double json_object_path_get_number(const JSON_Object *object, const JSON_Path *path) {
+    return json_value_get_number(json_object_path_get_value(object, path));
+}
+
+JSON_Object * json_object_path_get_object(const JSON_Object *object, const JSON_Path *path) {
+    return json_value_get_object(json_object_path_get_value(object, path));
+}
+
+JSON_Array * json_object_path_get_array(const JSON_Object *object, const JSON_Path *path) {
+    return json_value_get_array(json_object_path_get_value(object, path));
+}
+
+int json_object_path_get_boolean(const JSON_Object *object, const JSON_Path *path) {
+    return json_value_get_boolean(json_object_path_get_value(object, path));
+}
+
 size_t json_object_get_count(const JSON_Object *object) {
     return object ? object->count : 0;
 }
@@ -1610,11 +3059,11 @@ void json_value_free(JSON_Value *value) {
         default:
             break;
     }
-    parson_free(value);
+    pool_free(POOL_VALUE, value);
 }
 
 JSON_Value * json_value_init_object(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = (JSON_Value*)pool_malloc(POOL_VALUE, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
@@ -1622,14 +3071,14 @@ JSON_Value * json_value_init_object(void) {
     new_value->type = JSONObject;
     new_value->value.object = json_object_make(new_value);
     if (!new_value->value.object) {
-        parson_free(new_value);
+        pool_free(POOL_VALUE, new_value);
         return NULL;
     }
     return new_value;
 }
 
 JSON_Value * json_value_init_array(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = (JSON_Value*)pool_malloc(POOL_VALUE, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
@@ -1637,7 +3086,7 @@ JSON_Value * json_value_init_array(void) {
     new_value->type = JSONArray;
     new_value->value.array = json_array_make(new_value);
     if (!new_value->value.array) {
-        parson_free(new_value);
+        pool_free(POOL_VALUE, new_value);
         return NULL;
     }
     return new_value;
@@ -1675,7 +3124,7 @@ JSON_Value * json_value_init_number(double number) {
     if (IS_NUMBER_INVALID(number)) {
         return NULL;
     }
-    new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    new_value = (JSON_Value*)pool_malloc(POOL_VALUE, sizeof(JSON_Value));
     if (new_value == NULL) {
         return NULL;
     }
@@ -1686,7 +3135,7 @@ JSON_Value * json_value_init_number(double number) {
 }
 
 JSON_Value * json_value_init_boolean(int boolean) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = (JSON_Value*)pool_malloc(POOL_VALUE, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
@@ -1697,7 +3146,7 @@ JSON_Value * json_value_init_boolean(int boolean) {
 }
 
 JSON_Value * json_value_init_null(void) {
-    JSON_Value *new_value = (JSON_Value*)parson_malloc(sizeof(JSON_Value));
+    JSON_Value *new_value = (JSON_Value*)pool_malloc(POOL_VALUE, sizeof(JSON_Value));
     if (!new_value) {
         return NULL;
     }
@@ -1754,7 +3203,7 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value) {
                     json_value_free(return_value);
                     return NULL;
                 }
-                key_copy = parson_strdup(temp_key);
+                key_copy = key_make(temp_key, KEY_HEADER(temp_key)->length, KEY_HEADER(temp_key)->hash);
                 if (!key_copy) {
                     json_value_free(temp_value_copy);
                     json_value_free(return_value);
@@ -1762,7 +3211,7 @@ JSON_Value * json_value_deep_copy(const JSON_Value *value) {
                 }
                 res = json_object_add(temp_object_copy, key_copy, temp_value_copy);
                 if (res != JSONSuccess) {
-                    parson_free(key_copy);
+                    key_release(key_copy);
                     json_value_free(temp_value_copy);
                     json_value_free(return_value);
                     return NULL;
@@ -2110,15 +3559,15 @@ JSON_Status json_object_set_value(JSON_Object *object, const char *name, JSON_Va
         }
         cell_ix = json_object_get_cell_ix(object, name, strlen(name), hash, &found);
     }
-    key_copy = parson_strdup(name);
+    key_copy = key_make(name, strlen(name), hash);
     if (!key_copy) {
         return JSONFailure;
     }
     object->names[object->count] = key_copy;
-    object->cells[cell_ix] = object->count;
     object->values[object->count] = value;
     object->cell_ixs[object->count] = cell_ix;
     object->hashes[object->count] = hash;
+    json_object_set_cell(object, cell_ix, object->count);
     object->count++;
     value->parent = json_object_get_wrapping_value(object);
     return JSONSuccess;
@@ -2204,7 +3653,7 @@ JSON_Status json_object_dotset_value(JSON_Object *object, const char *name, JSON
         json_value_free(new_value);
         return JSONFailure;
     }
-    name_copy = parson_strndup(name, name_len);
+    name_copy = key_make(name, name_len, hash_string(name, name_len));
     if (!name_copy) {
         json_object_dotremove_internal(new_object, dot_pos + 1, 0);
         json_value_free(new_value);
@@ -2212,7 +3661,7 @@ JSON_Status json_object_dotset_value(JSON_Object *object, const char *name, JSON
     }
     status = json_object_add(object, name_copy, new_value);
     if (status != JSONSuccess) {
-        parson_free(name_copy);
+        key_release(name_copy);
         json_object_dotremove_internal(new_object, dot_pos + 1, 0);
         json_value_free(new_value);
         return JSONFailure;
@@ -2294,7 +3743,7 @@ JSON_Status json_object_clear(JSON_Object *object) {
         return JSONFailure;
     }
     for (i = 0; i < json_object_get_count(object); i++) {
-        parson_free(object->names[i]);
+        key_release(object->names[i]);
         object->names[i] = NULL;
         
         json_value_free(object->values[i]);
@@ -2304,6 +3753,9 @@ JSON_Status json_object_clear(JSON_Object *object) {
     for (i = 0; i < object->cell_capacity; i++) {
         object->cells[i] = OBJECT_INVALID_IX;
     }
+    if (object->ctrl != NULL) {
+        memset(object->ctrl, CTRL_EMPTY, object->cell_capacity + CTRL_GROUP_WIDTH);
+    }
     return JSONSuccess;
 }
 
@@ -2461,6 +3913,7 @@ int json_boolean(const JSON_Value *value) {
 }
 
 void json_set_allocation_functions(JSON_Malloc_Function malloc_fun, JSON_Free_Function free_fun) {
+    pool_drain(); /* pooled blocks belong to the previous allocator */
     parson_malloc = malloc_fun;
     parson_free = free_fun;
 }
@@ -2469,6 +3922,21 @@ void json_set_escape_slashes(int escape_slashes) {
     parson_escape_slashes = escape_slashes;
 }
 
+void json_set_key_interning(int key_interning) {
+    parson_key_interning = key_interning;
+}
+
+void json_set_node_pooling(int node_pooling) {
+    parson_node_pooling = node_pooling;
+    if (!node_pooling) {
+        pool_drain();
+    }
+}
+
+void json_release_pooled_memory(void) {
+    pool_drain();
+}
+
 void json_set_float_serialization_format(const char *format) {
     if (parson_float_format) {
         parson_free(parson_float_format);
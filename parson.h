@@ -46,6 +46,10 @@ extern "C"
 typedef struct json_object_t JSON_Object;
 typedef struct json_array_t  JSON_Array;
 typedef struct json_value_t  JSON_Value;
+typedef struct json_lazy_t   JSON_Lazy;
+typedef struct json_path_t   JSON_Path;
+typedef struct json_tape_t   JSON_Tape;
+typedef struct json_tape_value_t JSON_Tape_Value;
 
 enum json_value_type {
     JSONError   = -1,
@@ -81,6 +85,20 @@ void json_set_allocation_functions(JSON_Malloc_Function malloc_fun, JSON_Free_Fu
  This function sets a global setting and is not thread safe. */
 void json_set_escape_slashes(int escape_slashes);
 
+/* Sets if identical object keys should share a single string while parsing (disabled by default).
+   Keys are shared only within one parsed document, which makes large arrays of similar objects
+   use less memory. This function sets a global setting and is not thread safe. */
+void json_set_key_interning(int key_interning);
+
+/* Sets if freed values, objects, arrays and small object/array tables should be kept on free lists
+   and reused by later allocations instead of going back to free (disabled by default). Free lists
+   are per thread and bounded; disabling pooling releases the calling thread's lists. */
+void json_set_node_pooling(int node_pooling);
+
+/* Frees the blocks kept on the calling thread's free lists. Threads that used parson with node
+   pooling enabled should call it before exiting. */
+void json_release_pooled_memory(void);
+
 /* Sets float format used for serialization of numbers.
    Make sure it can't serialize to a string longer than PARSON_NUM_BUF_SIZE.
    If format is null then the default format is used. */
@@ -104,6 +122,12 @@ JSON_Value * json_parse_string(const char *string);
     returns NULL in case of error */
 JSON_Value * json_parse_string_with_comments(const char *string);
 
+/*  Parses a JSON string whose top-level value is a large array using up to `threads` threads.
+    The array is split at element boundaries, the parts are parsed concurrently and then joined
+    into a single array. Other values, small arrays and builds without PARSON_ENABLE_THREADS are
+    parsed with json_parse_string. Returns NULL in case of error. */
+JSON_Value * json_parse_string_parallel(const char *string, unsigned int threads);
+
 /* Serialization */
 size_t      json_serialization_size(const JSON_Value *value); /* returns 0 on fail */
 JSON_Status json_serialize_to_buffer(const JSON_Value *value, char *buf, size_t buf_size_in_bytes);
@@ -156,6 +180,20 @@ JSON_Array  * json_object_dotget_array  (const JSON_Object *object, const char *
 double        json_object_dotget_number (const JSON_Object *object, const char *name); /* returns 0 on fail */
 int           json_object_dotget_boolean(const JSON_Object *object, const char *name); /* returns -1 on fail */
 
+/* Compiled dotted names: json_path_compile splits the name and hashes every segment once,
+ so looking the same path up in many objects (e.g. every item of an array) doesn't repeat
+ any string processing. Paths behave exactly like dotget names. */
+JSON_Path   * json_path_compile(const char *name); /* returns NULL in case of error */
+void          json_path_free   (JSON_Path *path);
+
+JSON_Value  * json_object_path_get_value  (const JSON_Object *object, const JSON_Path *path);
+const char  * json_object_path_get_string (const JSON_Object *object, const JSON_Path *path);
+size_t        json_object_path_get_string_len(const JSON_Object *object, const JSON_Path *path); /* doesn't account for last null character */
+JSON_Object * json_object_path_get_object (const JSON_Object *object, const JSON_Path *path);
+JSON_Array  * json_object_path_get_array  (const JSON_Object *object, const JSON_Path *path);
+double        json_object_path_get_number (const JSON_Object *object, const JSON_Path *path); /* returns 0 on fail */
+int           json_object_path_get_boolean(const JSON_Object *object, const JSON_Path *path); /* returns -1 on fail */
+
 /* Functions to get available names */
 size_t        json_object_get_count   (const JSON_Object *object);
 const char  * json_object_get_name    (const JSON_Object *object, size_t index);
@@ -267,6 +305,64 @@ size_t          json_string_len(const JSON_Value *value); /* doesn't account for
 double          json_number (const JSON_Value *value);
 int             json_boolean(const JSON_Value *value);
 
+/*
+ *JSON Lazy
+ * Parses only the top-level object or array of a document: members are indexed, and each one
+ * is parsed into a JSON_Value the first time it's accessed. Members that are never accessed are
+ * never unescaped or allocated, and are only checked for balanced brackets. Returned values are
+ * owned by the JSON_Lazy and freed with it. If an object has duplicate names, the first one wins.
+ */
+JSON_Lazy *     json_lazy_parse_string(const char *string); /* returns NULL in case of error */
+void            json_lazy_free(JSON_Lazy *lazy);
+JSON_Value_Type json_lazy_get_type(const JSON_Lazy *lazy); /* JSONObject or JSONArray */
+size_t          json_lazy_get_count(const JSON_Lazy *lazy);
+
+JSON_Value  *   json_lazy_object_get_value (JSON_Lazy *lazy, const char *name);
+const char  *   json_lazy_object_get_string(JSON_Lazy *lazy, const char *name);
+JSON_Object *   json_lazy_object_get_object(JSON_Lazy *lazy, const char *name);
+JSON_Array  *   json_lazy_object_get_array (JSON_Lazy *lazy, const char *name);
+double          json_lazy_object_get_number(JSON_Lazy *lazy, const char *name); /* returns 0 on fail */
+const char  *   json_lazy_object_get_name  (const JSON_Lazy *lazy, size_t index);
+
+JSON_Value  *   json_lazy_get_value_at    (JSON_Lazy *lazy, size_t index); /* object member or array item */
+JSON_Object *   json_lazy_array_get_object(JSON_Lazy *lazy, size_t index);
+
+/*
+ *JSON Tape
+ * Read-only alternative to the JSON_Value tree: a whole document is parsed into one
+ * contiguous array of values, with strings unescaped in place in a single copy of the
+ * source. Values are addressed by pointers into the tape and stay valid until the tape
+ * is freed. Array items and object members are indexed, so access by position is O(1),
+ * while lookup by name scans the object's members.
+ */
+JSON_Tape *             json_tape_parse_string(const char *string); /* returns NULL in case of error */
+void                    json_tape_free(JSON_Tape *tape);
+const JSON_Tape_Value * json_tape_get_root(const JSON_Tape *tape);
+
+JSON_Value_Type         json_tape_value_get_type(const JSON_Tape_Value *value);
+const char *            json_tape_value_get_string(const JSON_Tape_Value *value);
+size_t                  json_tape_value_get_string_len(const JSON_Tape_Value *value); /* doesn't account for last null character */
+double                  json_tape_value_get_number(const JSON_Tape_Value *value); /* returns 0 on fail */
+int                     json_tape_value_get_boolean(const JSON_Tape_Value *value); /* returns -1 on fail */
+
+const JSON_Tape_Value * json_tape_object_get_value(const JSON_Tape_Value *object, const char *name);
+const char *            json_tape_object_get_string(const JSON_Tape_Value *object, const char *name);
+size_t                  json_tape_object_get_string_len(const JSON_Tape_Value *object, const char *name); /* doesn't account for last null character */
+const JSON_Tape_Value * json_tape_object_get_object(const JSON_Tape_Value *object, const char *name);
+const JSON_Tape_Value * json_tape_object_get_array(const JSON_Tape_Value *object, const char *name);
+double                  json_tape_object_get_number(const JSON_Tape_Value *object, const char *name); /* returns 0 on fail */
+int                     json_tape_object_get_boolean(const JSON_Tape_Value *object, const char *name); /* returns -1 on fail */
+size_t                  json_tape_object_get_count(const JSON_Tape_Value *object);
+const char *            json_tape_object_get_name(const JSON_Tape_Value *object, size_t index);
+const JSON_Tape_Value * json_tape_object_get_value_at(const JSON_Tape_Value *object, size_t index);
+
+const JSON_Tape_Value * json_tape_array_get_value(const JSON_Tape_Value *array, size_t index);
+const char *            json_tape_array_get_string(const JSON_Tape_Value *array, size_t index);
+const JSON_Tape_Value * json_tape_array_get_object(const JSON_Tape_Value *array, size_t index);
+const JSON_Tape_Value * json_tape_array_get_array(const JSON_Tape_Value *array, size_t index);
+double                  json_tape_array_get_number(const JSON_Tape_Value *array, size_t index); /* returns 0 on fail */
+size_t                  json_tape_array_get_count(const JSON_Tape_Value *array);
+
 #ifdef __cplusplus
 }
 #endif
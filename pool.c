@@ -0,0 +1,283 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "pool.h"
+#include "helpers.h"
+#include "http.h"
+#include "buffer.h"
+
+void pool_init(connection_pool *pool, const char *host, int port, size_t max_idle)
+{
+    pthread_mutex_init(&pool->lock, NULL);
+    snprintf(pool->host, sizeof(pool->host), "%s", host);
+    pool->port = port;
+    pool->idle_count = 0;
+    pool->max_idle = max_idle;
+    pool->opened = 0;
+    pool->reused = 0;
+    flight_init(&pool->flights);
+
+    pool->idle = calloc(max_idle ? max_idle : 1, sizeof(int));
+    if (!pool->idle) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void pool_destroy(connection_pool *pool)
+{
+    // Nobody else uses the pool anymore, close what is left
+    for (size_t i = 0; i < pool->idle_count; i++) {
+        close_connection(pool->idle[i]);
+    }
+
+    free(pool->idle);
+    pool->idle = NULL;
+    pool->idle_count = 0;
+    flight_destroy(&pool->flights);
+    pthread_mutex_destroy(&pool->lock);
+}
+
+// checks if the server already closed an idle connection, before anything is sent on it
+static int is_closed(int sockfd)
+{
+    char byte;
+    ssize_t peeked = recv(sockfd, &byte, 1, MSG_PEEK | MSG_DONTWAIT);
+    return peeked == 0 || (peeked < 0 && errno != EAGAIN && errno != EWOULDBLOCK);
+}
+
+int pool_acquire(connection_pool *pool, int *reused)
+{
+    // Prefer the most recently used connection, it is the least likely to have timed out
+    pthread_mutex_lock(&pool->lock);
+    while (pool->idle_count > 0) {
+        int sockfd = pool->idle[--pool->idle_count];
+        if (is_closed(sockfd)) {
+            close_connection(sockfd);
+            continue;
+        }
+        pool->reused++;
+        pthread_mutex_unlock(&pool->lock);
+        *reused = 1;
+        return sockfd;
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    // Connect outside the lock, it takes a round trip
+    *reused = 0;
+    int sockfd = try_open_connection(pool->host, pool->port, AF_INET, SOCK_STREAM, 0);
+    if (sockfd >= 0) {
+        pthread_mutex_lock(&pool->lock);
+        pool->opened++;
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    return sockfd;
+}
+
+void pool_release(connection_pool *pool, int sockfd, int keep_alive)
+{
+    if (keep_alive) {
+        pthread_mutex_lock(&pool->lock);
+        if (pool->idle_count < pool->max_idle) {
+            pool->idle[pool->idle_count++] = sockfd;
+            sockfd = -1;
+        }
+        pthread_mutex_unlock(&pool->lock);
+    }
+
+    // Not reusable, or the pool is full
+    if (sockfd >= 0) {
+        close_connection(sockfd);
+    }
+}
+
+static int keeps_connection(const char *response)
+{
+    http_response parsed;
+    char connection[16];
+
+    // HTTP/1.1 connections stay open unless the server says otherwise
+    if (http_parse_response(response, &parsed) < 0 || strncmp(response, "HTTP/1.1", 8) != 0) {
+        return 0;
+    }
+
+    return !http_get_header(&parsed, "Connection", connection, sizeof(connection)) ||
+           strcmp(connection, "close") != 0;
+}
+
+// checks if a request may be sent again without knowing whether the server carried it
+// out: its method must be idempotent (a POST twice adds two books)
+static int is_idempotent(const char *message)
+{
+    static const char *methods[] = { "GET ", "HEAD ", "PUT ", "DELETE ", "OPTIONS " };
+
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (strncmp(message, methods[i], strlen(methods[i])) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static int all_idempotent(char **messages, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (!is_idempotent(messages[i])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+char *pool_request(connection_pool *pool, const char *message)
+{
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int reused;
+        int sockfd = pool_acquire(pool, &reused);
+        if (sockfd < 0) {
+            return NULL;
+        }
+
+        char *response = NULL;
+        if (try_send_to_server(sockfd, message) == 0) {
+            response = try_receive_from_server(sockfd);
+        }
+
+        if (response) {
+            pool_release(pool, sockfd, keeps_connection(response));
+            return response;
+        }
+
+        // The server may have closed an idle connection, only then is a retry worth it,
+        // and only if the request can safely be carried out twice
+        close_connection(sockfd);
+        if (!reused || !is_idempotent(message)) {
+            break;
+        }
+    }
+
+    return NULL;
+}
+
+// takes the next response off the data read so far, reading more as needed;
+// returns NULL if the connection failed or closed before it was complete
+static char *next_response(int sockfd, buffer *pending)
+{
+    char chunk[BUFLEN];
+    size_t length = 0;
+    int complete;
+
+    while ((complete = http_response_length(pending->data ? pending->data : "", pending->size, &length)) != 1) {
+        ssize_t bytes = read(sockfd, chunk, sizeof(chunk));
+        if (bytes <= 0) {
+            // A body without a length ends with the connection
+            if (bytes == 0 && complete < 0) {
+                length = pending->size;
+                break;
+            }
+            return NULL;
+        }
+
+        // Keep the data null-terminated, without counting the terminator
+        buffer_add(pending, chunk, (size_t)bytes);
+        buffer_add(pending, "", 1);
+        pending->size--;
+    }
+
+    char *response = malloc(length + 1);
+    if (!response) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    memcpy(response, pending->data, length);
+    response[length] = '\0';
+
+    // What follows belongs to the next response, terminator included
+    memmove(pending->data, pending->data + length, pending->size - length + 1);
+    pending->size -= length;
+    return response;
+}
+
+size_t pool_pipeline(connection_pool *pool, char **messages, size_t count, char **responses)
+{
+    size_t received = 0;
+    int retries = 1;
+
+    while (received < count) {
+        int reused;
+        int sockfd = pool_acquire(pool, &reused);
+        if (sockfd < 0) {
+            break;
+        }
+
+        // Write every request left before reading any response
+        size_t sent = received;
+        while (sent < count && try_send_to_server(sockfd, messages[sent]) == 0) {
+            sent++;
+        }
+
+        // The responses come back in the order of the requests
+        size_t first = received;
+        buffer pending = buffer_init();
+        while (received < sent && (responses[received] = next_response(sockfd, &pending)) != NULL) {
+            received++;
+        }
+
+        int drained = pending.size == 0;
+        buffer_destroy(&pending);
+
+        if (received == count) {
+            pool_release(pool, sockfd, drained && keeps_connection(responses[count - 1]));
+            break;
+        }
+        close_connection(sockfd);
+
+        // Requests left without an answer may have been carried out, only those that can
+        // safely run twice are sent again; the others are reported as failed by the caller
+        if (!all_idempotent(messages + received, count - received)) {
+            break;
+        }
+
+        // A server closing the connection on purpose ignores the requests after it
+        if (received > first && !keeps_connection(responses[received - 1])) {
+            continue;
+        }
+
+        // So does one that dropped an idle connection before answering anything;
+        // in any other case some requests may have been carried out already
+        if (received > first || !reused || retries-- == 0) {
+            break;
+        }
+    }
+
+    return received;
+}
+
+typedef struct {
+    connection_pool *pool;
+    const char *message;
+} pooled_request;
+
+static char *send_pooled_request(void *arg)
+{
+    pooled_request *request = arg;
+    return pool_request(request->pool, request->message);
+}
+
+flight_result *pool_request_shared(connection_pool *pool, const char *message)
+{
+    // The whole request, token included, tells identical requests apart
+    pooled_request request = { pool, message };
+    return flight_do(&pool->flights, message, send_pooled_request, &request);
+}
+
+void pool_release_result(connection_pool *pool, flight_result *result)
+{
+    flight_release(&pool->flights, result);
+}
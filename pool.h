@@ -0,0 +1,52 @@
+#ifndef POOL_H_
+#define POOL_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "flight.h"
+
+// Keep-alive connections to the server, shared by the worker threads
+typedef struct {
+    pthread_mutex_t lock;  // guards everything below
+    char host[64];         // server address
+    int port;              // server port
+    int *idle;             // connections waiting for the next request
+    size_t idle_count;     // connections in idle
+    size_t max_idle;       // connections kept at most, the others are closed
+    size_t opened;         // connections opened so far
+    size_t reused;         // requests sent over an idle connection
+    flight_group flights;  // GET requests in flight, shared by identical ones
+} connection_pool;
+
+// initializes an empty pool keeping at most max_idle connections to host:port
+void pool_init(connection_pool *pool, const char *host, int port, size_t max_idle);
+
+// closes every idle connection
+void pool_destroy(connection_pool *pool);
+
+// returns an idle connection the server hasn't closed, or a new one (reused tells which);
+// -1 if none could be opened
+int pool_acquire(connection_pool *pool, int *reused);
+
+// gives a connection back; it is closed instead if it can't carry another request
+void pool_release(connection_pool *pool, int sockfd, int keep_alive);
+
+// sends a request over a pooled connection and returns the raw response, or NULL; an
+// idempotent request (GET, DELETE, ...) that fails on a reused connection is retried once
+// on a new one, a POST never is
+char *pool_request(connection_pool *pool, const char *message);
+
+// sends count requests back to back over one pooled connection, then reads their responses
+// into responses (NULL where none arrived); returns how many responses were read. Requests
+// left unanswered are only sent again if every one of them is idempotent
+size_t pool_pipeline(connection_pool *pool, char **messages, size_t count, char **responses);
+
+// like pool_request for a GET, but callers sending an identical request while it is in
+// flight share its response; the result is read-only, release it with pool_release_result
+flight_result *pool_request_shared(connection_pool *pool, const char *message);
+
+// drops a result returned by pool_request_shared
+void pool_release_result(connection_pool *pool, flight_result *result);
+
+#endif
@@ -0,0 +1,149 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "prefetch.h"
+#include "functions.h"
+
+void prefetch_init(book_prefetcher *prefetcher, connection_pool *pool, task_engine *engine, size_t limit)
+{
+    pthread_mutex_init(&prefetcher->lock, NULL);
+    prefetcher->pool = pool;
+    prefetcher->engine = engine;
+    prefetcher->limit = limit;
+    prefetcher->generation = 0;
+    prefetcher->done = NULL;
+}
+
+static void free_job(book_prefetcher *prefetcher, prefetch_job *job)
+{
+    pool_release_result(prefetcher->pool, job->result);
+    free(job->message);
+    free(job);
+}
+
+static prefetch_job *take_done(book_prefetcher *prefetcher)
+{
+    pthread_mutex_lock(&prefetcher->lock);
+    prefetch_job *done = prefetcher->done;
+    prefetcher->done = NULL;
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    return done;
+}
+
+static void drop_done(book_prefetcher *prefetcher)
+{
+    prefetch_job *job = take_done(prefetcher);
+    while (job) {
+        prefetch_job *next = job->next;
+        free_job(prefetcher, job);
+        job = next;
+    }
+}
+
+void prefetch_destroy(book_prefetcher *prefetcher)
+{
+    drop_done(prefetcher);
+    pthread_mutex_destroy(&prefetcher->lock);
+}
+
+static void prefetch_task(void *arg)
+{
+    prefetch_job *job = arg;
+    book_prefetcher *prefetcher = job->owner;
+
+    // A canceled request isn't sent at all
+    pthread_mutex_lock(&prefetcher->lock);
+    int canceled = job->generation != prefetcher->generation;
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    if (!canceled) {
+        job->result = pool_request_shared(prefetcher->pool, job->message);
+    }
+
+    // Hand the response over to the main thread
+    pthread_mutex_lock(&prefetcher->lock);
+    job->next = prefetcher->done;
+    prefetcher->done = job;
+    pthread_mutex_unlock(&prefetcher->lock);
+}
+
+void prefetch_listing(book_prefetcher *prefetcher, const char *listing, char *token,
+                      book_cache *cache, book_catalog *catalog)
+{
+    if (prefetcher->limit == 0 || !token) {
+        return;
+    }
+
+    // A newer listing supersedes what is left of the previous batch
+    prefetch_cancel(prefetcher);
+
+    int *ids;
+    size_t count = collect_new_books(listing, prefetcher->limit, cache, catalog, &ids);
+
+    for (size_t i = 0; i < count; i++) {
+        prefetch_job *job = calloc(1, sizeof(prefetch_job));
+        if (job == NULL) {
+            fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+            exit(EXIT_FAILURE);
+        }
+
+        char id_str[LEN];
+        snprintf(id_str, sizeof(id_str), "%d", ids[i]);
+        char *url = build_url(GET_PATH, id_str);
+        job->owner = prefetcher;
+        job->id = ids[i];
+        job->message = create_get_message(url, token, NULL);
+        free(url);
+
+        pthread_mutex_lock(&prefetcher->lock);
+        job->generation = prefetcher->generation;
+        pthread_mutex_unlock(&prefetcher->lock);
+
+        // Only idle workers pick it up, the commands typed meanwhile go first
+        if (engine_submit_background(prefetcher->engine, prefetch_task, job) < 0) {
+            free_job(prefetcher, job);
+            break;
+        }
+    }
+
+    free(ids);
+}
+
+size_t prefetch_collect(book_prefetcher *prefetcher, book_cache *cache, book_catalog *catalog)
+{
+    size_t stored = 0;
+
+    pthread_mutex_lock(&prefetcher->lock);
+    unsigned generation = prefetcher->generation;
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    prefetch_job *job = take_done(prefetcher);
+    while (job) {
+        prefetch_job *next = job->next;
+
+        // Books from a canceled batch may belong to another user, and a book
+        // fetched meanwhile in the foreground is at least as recent
+        if (job->generation == generation && job->result &&
+            !book_is_stored(cache, catalog, job->id) &&
+            store_fetched_book(job->result, cache, catalog, job->id) == 0) {
+            stored++;
+        }
+
+        free_job(prefetcher, job);
+        job = next;
+    }
+
+    return stored;
+}
+
+void prefetch_cancel(book_prefetcher *prefetcher)
+{
+    // Queued requests see the new generation and skip sending
+    pthread_mutex_lock(&prefetcher->lock);
+    prefetcher->generation++;
+    pthread_mutex_unlock(&prefetcher->lock);
+
+    // Requests running now finish later and are dropped by prefetch_collect
+    drop_done(prefetcher);
+}
@@ -0,0 +1,49 @@
+#ifndef PREFETCH_H_
+#define PREFETCH_H_
+
+#include <stddef.h>
+#include <pthread.h>
+
+#include "cache.h"
+#include "catalog.h"
+#include "pool.h"
+#include "engine.h"
+
+// One get_book request sent in the background
+typedef struct prefetch_job {
+    struct book_prefetcher *owner;
+    int id;                    // book requested
+    unsigned generation;       // batch the request belongs to
+    char *message;             // the request
+    flight_result *result;     // the response, NULL if it was canceled or failed
+    struct prefetch_job *next; // next finished request
+} prefetch_job;
+
+// Fetches listed books on idle engine threads; the main thread stores what arrived
+typedef struct book_prefetcher {
+    pthread_mutex_t lock;  // guards everything below
+    connection_pool *pool; // where the requests are sent
+    task_engine *engine;   // runs the requests as background tasks
+    size_t limit;          // listed books prefetched at most, 0 disables prefetching
+    unsigned generation;   // current batch, requests of older ones are dropped
+    prefetch_job *done;    // finished requests, not stored yet
+} book_prefetcher;
+
+// prefetches at most limit books of every listing (0 disables it)
+void prefetch_init(book_prefetcher *prefetcher, connection_pool *pool, task_engine *engine, size_t limit);
+
+// call after the engine stopped, drops whatever wasn't stored
+void prefetch_destroy(book_prefetcher *prefetcher);
+
+// fetches in the background the first books of a get_books listing that aren't stored yet,
+// canceling an earlier batch still running
+void prefetch_listing(book_prefetcher *prefetcher, const char *listing, char *token,
+                      book_cache *cache, book_catalog *catalog);
+
+// stores the books fetched since the last call; returns how many were stored
+size_t prefetch_collect(book_prefetcher *prefetcher, book_cache *cache, book_catalog *catalog);
+
+// drops the queued requests and the results still to come (e.g. when the user changes)
+void prefetch_cancel(book_prefetcher *prefetcher);
+
+#endif
@@ -0,0 +1,188 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "refresh.h"
+#include "functions.h"
+#include "jwt.h"
+
+// One renewal sent in the background
+typedef struct {
+    token_refresher *owner;
+    unsigned generation;   // renewals of an earlier generation are dropped
+    char *message;         // the enter_library request, with its own copy of the cookie
+} refresh_job;
+
+void refresh_init(token_refresher *refresher, connection_pool *pool, task_engine *engine)
+{
+    pthread_mutex_init(&refresher->lock, NULL);
+    pthread_cond_init(&refresher->finished, NULL);
+    refresher->pool = pool;
+    refresher->engine = engine;
+    refresher->running = 0;
+    refresher->generation = 0;
+    refresher->response = NULL;
+    refresher->renewed = 0;
+}
+
+void refresh_destroy(token_refresher *refresher)
+{
+    free(refresher->response);
+    pthread_cond_destroy(&refresher->finished);
+    pthread_mutex_destroy(&refresher->lock);
+}
+
+// token given by an enter_library response, NULL if there is none; JSON is only
+// parsed on the main thread
+static char *token_from_response(const char *response)
+{
+    http_response parsed;
+    if (!response || http_parse_response(response, &parsed) < 0 || parsed.status != 200) {
+        return NULL;
+    }
+
+    JSON_Lazy *result = json_lazy_parse_string(parsed.body);
+    const char *value = json_lazy_object_get_string(result, "token");
+    char *token = value ? duplicate(value) : NULL;
+    json_lazy_free(result);
+
+    return token;
+}
+
+static void refresh_task(void *arg)
+{
+    refresh_job *job = arg;
+    token_refresher *refresher = job->owner;
+
+    // A canceled renewal isn't sent at all
+    pthread_mutex_lock(&refresher->lock);
+    int canceled = job->generation != refresher->generation;
+    pthread_mutex_unlock(&refresher->lock);
+
+    char *response = canceled ? NULL : pool_request(refresher->pool, job->message);
+
+    // Hand the response over to the main thread
+    pthread_mutex_lock(&refresher->lock);
+    if (job->generation == refresher->generation) {
+        free(refresher->response);
+        refresher->response = response;
+        response = NULL;
+        refresher->running = 0;
+    }
+    pthread_cond_broadcast(&refresher->finished);
+    pthread_mutex_unlock(&refresher->lock);
+
+    free(response);
+    free(job->message);
+    free(job);
+}
+
+// the token of a finished background renewal, NULL if there is none
+static char *take_renewed(token_refresher *refresher)
+{
+    pthread_mutex_lock(&refresher->lock);
+    char *response = refresher->response;
+    refresher->response = NULL;
+    pthread_mutex_unlock(&refresher->lock);
+
+    char *token = token_from_response(response);
+    free(response);
+    return token;
+}
+
+static void replace_token(token_refresher *refresher, char **token, char *renewed)
+{
+    free(*token);
+    *token = renewed;
+    refresher->renewed++;
+}
+
+void refresh_token(token_refresher *refresher, const char *cookie, char **token)
+{
+    if (!cookie || !*token) {
+        return;
+    }
+
+    char *renewed = take_renewed(refresher);
+    if (renewed) {
+        replace_token(refresher, token, renewed);
+    }
+
+    // Without worker threads nothing is renewed ahead, so the command does it earlier
+    time_t margin = refresher->engine->thread_count > 0 ? REFRESH_MARGIN : REFRESH_AHEAD;
+    time_t expires = jwt_expiry(*token);
+    if (expires == 0 || expires - time(NULL) > margin) {
+        return;
+    }
+
+    // About to expire: wait for the renewal in flight, or renew now
+    pthread_mutex_lock(&refresher->lock);
+    while (refresher->running) {
+        pthread_cond_wait(&refresher->finished, &refresher->lock);
+    }
+    pthread_mutex_unlock(&refresher->lock);
+
+    renewed = take_renewed(refresher);
+    if (!renewed) {
+        char *message = build_enter_library_request((char *)cookie);
+        char *response = pool_request(refresher->pool, message);
+        renewed = token_from_response(response);
+        free(response);
+        free(message);
+    }
+
+    // If the server refused, the command finds out with the old token
+    if (renewed) {
+        replace_token(refresher, token, renewed);
+    }
+}
+
+void refresh_ahead(token_refresher *refresher, const char *cookie, const char *token)
+{
+    if (!cookie || !token || refresher->engine->thread_count == 0) {
+        return;
+    }
+
+    time_t expires = jwt_expiry(token);
+    if (expires == 0 || expires - time(NULL) > REFRESH_AHEAD) {
+        return;
+    }
+
+    // One renewal at a time, and none while a new token waits to be taken
+    pthread_mutex_lock(&refresher->lock);
+    if (refresher->running || refresher->response) {
+        pthread_mutex_unlock(&refresher->lock);
+        return;
+    }
+
+    refresh_job *job = malloc(sizeof(refresh_job));
+    if (job == NULL) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    job->owner = refresher;
+    job->generation = refresher->generation;
+    job->message = build_enter_library_request((char *)cookie);
+    refresher->running = 1;
+    pthread_mutex_unlock(&refresher->lock);
+
+    // Only idle workers pick it up, like prefetched books
+    if (engine_submit_background(refresher->engine, refresh_task, job) < 0) {
+        pthread_mutex_lock(&refresher->lock);
+        refresher->running = 0;
+        pthread_mutex_unlock(&refresher->lock);
+        free(job->message);
+        free(job);
+    }
+}
+
+void refresh_cancel(token_refresher *refresher)
+{
+    // The renewal in flight sees the new generation and drops its answer
+    pthread_mutex_lock(&refresher->lock);
+    refresher->generation++;
+    refresher->running = 0;
+    free(refresher->response);
+    refresher->response = NULL;
+    pthread_cond_broadcast(&refresher->finished);
+    pthread_mutex_unlock(&refresher->lock);
+}
@@ -0,0 +1,41 @@
+#ifndef REFRESH_H_
+#define REFRESH_H_
+
+#include <pthread.h>
+#include <time.h>
+
+#include "pool.h"
+#include "engine.h"
+
+#define REFRESH_AHEAD 60   // seconds before its exp a token starts being renewed in the background
+#define REFRESH_MARGIN 5   // seconds before its exp a command waits for a new token
+
+// Renews the library token before it expires, on an idle engine thread when there is one.
+// The main thread takes the new token between commands
+typedef struct {
+    pthread_mutex_t lock;   // guards everything below
+    pthread_cond_t finished; // signaled when a background renewal is done
+    connection_pool *pool;  // where the requests are sent
+    task_engine *engine;    // runs the renewals as background tasks
+    int running;            // a background renewal was submitted and isn't done yet
+    unsigned generation;    // bumped by refresh_cancel, older renewals are dropped
+    char *response;         // answer of the last background renewal, not taken yet
+    size_t renewed;         // tokens renewed so far
+} token_refresher;
+
+void refresh_init(token_refresher *refresher, connection_pool *pool, task_engine *engine);
+
+// call after the engine stopped
+void refresh_destroy(token_refresher *refresher);
+
+// before a command that uses the token: replaces *token with one renewed in the background, and
+// renews it right away (or waits for the renewal in flight) if it expires within REFRESH_MARGIN
+void refresh_token(token_refresher *refresher, const char *cookie, char **token);
+
+// starts renewing the token in the background if it expires within REFRESH_AHEAD
+void refresh_ahead(token_refresher *refresher, const char *cookie, const char *token);
+
+// drops the renewal in flight (e.g. on logout)
+void refresh_cancel(token_refresher *refresher);
+
+#endif
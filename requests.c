@@ -62,6 +62,14 @@ char *compute_delete_request(char *host, char *url,
 
 char *compute_get_request(char *host, char *url, char *query_params,
                           char **cookies, int cookies_count, int type)
+{
+    return compute_get_request_with_headers(host, url, query_params, cookies, cookies_count,
+                                            type, NULL, 0);
+}
+
+char *compute_get_request_with_headers(char *host, char *url, char *query_params,
+                                       char **cookies, int cookies_count, int type,
+                                       char **headers, int headers_count)
 {
     char *message = calloc(BUFLEN, sizeof(char));
     if (!message) {
@@ -104,7 +112,12 @@ char *compute_get_request(char *host, char *url, char *query_params,
         compute_message(message, line);
     }
 
-    // Step 4: add final new line
+    // Step 4 (optional): add extra headers, each one already formatted as "Name: value"
+    for (int i = 0; i < headers_count; i++) {
+        compute_message(message, headers[i]);
+    }
+
+    // Step 5: add final new line
     compute_message(message, "");
 
     free(line);
@@ -12,6 +12,12 @@ char *compute_delete_request(char *host, char *url,
 char *compute_get_request(char *host, char *url, char *query_params,
 							char **cookies, int cookies_count, int type);
 
+// same as compute_get_request, with extra header lines (e.g. "If-None-Match: ...")
+// added after the cookies; headers can be NULL if headers_count is 0
+char *compute_get_request_with_headers(char *host, char *url, char *query_params,
+							char **cookies, int cookies_count, int type,
+							char **headers, int headers_count);
+
 // computes and returns a POST request string (cookies can be NULL if not needed)
 char *compute_post_request(char *host, char *url, char* content_type, char **body_data,
 							int body_data_fields_count, char** cookies, int cookies_count, int type);
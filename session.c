@@ -0,0 +1,359 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "session.h"
+#include "jwt.h"
+
+static char *copy_or_null(const char *text)
+{
+    if (!text) {
+        return NULL;
+    }
+
+    char *copy = strdup(text);
+    if (!copy) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    return copy;
+}
+
+static int same_text(const char *a, const char *b)
+{
+    return a == b || (a && b && !strcmp(a, b));
+}
+
+// remembers what the file holds
+static void set_stored(session_store *store, const char *user, const char *cookie, const char *token)
+{
+    free(store->user);
+    free(store->cookie);
+    free(store->token);
+    store->user = copy_or_null(user);
+    store->cookie = copy_or_null(cookie);
+    store->token = copy_or_null(token);
+}
+
+static int read_random(uint8_t *data, size_t size)
+{
+    int fd = open("/dev/urandom", O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    ssize_t bytes = read(fd, data, size);
+    close(fd);
+    return bytes == (ssize_t)size ? 0 : -1;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// reads the key from 64 hex digits
+static int parse_key(const char *hex, uint8_t key[CHACHA_KEY_SIZE])
+{
+    if (strlen(hex) != 2 * CHACHA_KEY_SIZE) {
+        return -1;
+    }
+
+    for (size_t i = 0; i < CHACHA_KEY_SIZE; i++) {
+        int high = hex_digit(hex[2 * i]);
+        int low = hex_digit(hex[2 * i + 1]);
+        if (high < 0 || low < 0) {
+            return -1;
+        }
+        key[i] = (uint8_t)(high << 4 | low);
+    }
+    return 0;
+}
+
+// reads the key file, creating it with a new random key the first time
+static int load_key_file(const char *path, uint8_t key[CHACHA_KEY_SIZE])
+{
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0600);
+    if (fd >= 0) {
+        int ok = read_random(key, CHACHA_KEY_SIZE) == 0 &&
+                 write(fd, key, CHACHA_KEY_SIZE) == CHACHA_KEY_SIZE;
+        close(fd);
+        if (!ok) {
+            unlink(path);
+            return -1;
+        }
+        return 0;
+    }
+
+    if (errno != EEXIST) {
+        return -1;
+    }
+
+    struct stat st;
+    fd = open(path, O_RDONLY);
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+
+    // A key others can read doesn't protect anything
+    if (st.st_mode & 077) {
+        fprintf(stderr, "%s must only be accessible by its owner (chmod 600)\n", path);
+        close(fd);
+        return -1;
+    }
+
+    ssize_t bytes = read(fd, key, CHACHA_KEY_SIZE);
+    close(fd);
+    return bytes == CHACHA_KEY_SIZE ? 0 : -1;
+}
+
+int session_open(session_store *store, const char *path, const char *key_path)
+{
+    memset(store, 0, sizeof(*store));
+    if (!path) {
+        return -1;
+    }
+
+    const char *hex = getenv(SESSION_KEY_ENV);
+    if (hex && *hex) {
+        if (parse_key(hex, store->key) < 0) {
+            fprintf(stderr, "%s must be 64 hex digits, the session isn't kept\n", SESSION_KEY_ENV);
+            return -1;
+        }
+        store->path = path;
+        return 0;
+    }
+
+    // Default key file in the home directory
+    char default_path[4096];
+    if (!key_path) {
+        const char *home = getenv("HOME");
+        if (!home) {
+            fprintf(stderr, "Set %s or give a key file, the session isn't kept\n", SESSION_KEY_ENV);
+            return -1;
+        }
+        snprintf(default_path, sizeof(default_path), "%s/%s", home, SESSION_KEY_FILE);
+        key_path = default_path;
+    }
+
+    if (load_key_file(key_path, store->key) < 0) {
+        fprintf(stderr, "Can't use the session key in %s, the session isn't kept\n", key_path);
+        return -1;
+    }
+
+    store->path = path;
+    return 0;
+}
+
+// Poly1305 tag of the magic, nonce and encrypted lines, keyed by the ChaCha20 block 0 of
+// the nonce (RFC 8439), which encryption skips by starting at block 1
+static void session_tag(const session_store *store, const uint8_t *nonce, const uint8_t *data,
+                        size_t size, uint8_t tag[POLY1305_TAG_SIZE])
+{
+    uint8_t mac_key[POLY1305_KEY_SIZE] = { 0 };
+    chacha20_xor(store->key, nonce, 0, mac_key, sizeof(mac_key));
+    poly1305_mac(mac_key, data, size, tag);
+}
+
+// value of "name=" in the decrypted lines, as a new string; NULL if it is missing or empty
+static char *find_field(char *text, const char *name)
+{
+    size_t len = strlen(name);
+
+    char *line = text;
+    while (line) {
+        if (!strncmp(line, name, len) && line[len] == '=') {
+            char *value = line + len + 1;
+            size_t value_len = strcspn(value, "\n");
+            if (value_len == 0) {
+                return NULL;
+            }
+
+            char *copy = malloc(value_len + 1);
+            if (!copy) {
+                fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+                exit(EXIT_FAILURE);
+            }
+            memcpy(copy, value, value_len);
+            copy[value_len] = '\0';
+            return copy;
+        }
+
+        line = strchr(line, '\n');
+        if (line) {
+            line++;
+        }
+    }
+
+    return NULL;
+}
+
+int session_load(session_store *store, char *user, size_t size, char **cookie, char **token)
+{
+    if (!store->path) {
+        return -1;
+    }
+
+    int fd = open(store->path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+
+    // The whole file is small: magic, nonce, the encrypted lines and the tag
+    uint8_t *data = malloc(SESSION_MAX_SIZE + 1);
+    if (!data) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+    size_t total = 0;
+    ssize_t bytes;
+    while (total < SESSION_MAX_SIZE && (bytes = read(fd, data + total, SESSION_MAX_SIZE - total)) > 0) {
+        total += (size_t)bytes;
+    }
+    close(fd);
+
+    size_t header = SESSION_MAGIC_SIZE + CHACHA_NONCE_SIZE;
+    if (total <= header + POLY1305_TAG_SIZE || memcmp(data, SESSION_MAGIC, SESSION_MAGIC_SIZE)) {
+        free(data);
+        return -1;
+    }
+
+    // Nothing is decrypted before the tag proves the file was written with this key
+    uint8_t *nonce = data + SESSION_MAGIC_SIZE;
+    size_t text_size = total - header - POLY1305_TAG_SIZE;
+    uint8_t tag[POLY1305_TAG_SIZE];
+    session_tag(store, nonce, data, header + text_size, tag);
+    if (!poly1305_equal(tag, data + header + text_size)) {
+        fprintf(stderr, "%s wasn't written with this key or was changed, ignoring it\n", store->path);
+        free(data);
+        return -1;
+    }
+
+    char *text = (char *)data + header;
+    chacha20_xor(store->key, nonce, 1, (uint8_t *)text, text_size);
+    text[text_size] = '\0';
+
+    if (strncmp(text, SESSION_HEADER, strlen(SESSION_HEADER))) {
+        free(data);
+        return -1;
+    }
+
+    char *stored_user = find_field(text, "user");
+    char *stored_cookie = find_field(text, "cookie");
+    char *stored_token = find_field(text, "token");
+    char *expires = find_field(text, "token_expires");
+    time_t token_expires = expires ? (time_t)strtoll(expires, NULL, 10) : 0;
+    free(expires);
+    free(data);
+
+    if (!stored_user || !stored_cookie) {
+        free(stored_user);
+        free(stored_cookie);
+        free(stored_token);
+        return -1;
+    }
+
+    // A library token past its expiry is no use, the cookie may still be
+    if (stored_token && token_expires && token_expires <= time(NULL)) {
+        free(stored_token);
+        stored_token = NULL;
+    }
+
+    snprintf(user, size, "%s", stored_user);
+    *cookie = stored_cookie;
+    *token = stored_token;
+    set_stored(store, stored_user, stored_cookie, stored_token);
+    free(stored_user);
+    return 0;
+}
+
+int session_update(session_store *store, const char *user, const char *cookie, const char *token)
+{
+    if (!store->path) {
+        return 0;
+    }
+
+    if (same_text(store->cookie, cookie) && same_text(store->token, token) &&
+        (!cookie || same_text(store->user, user))) {
+        return 0;
+    }
+
+    // Logged out: nothing is kept
+    if (!cookie) {
+        set_stored(store, NULL, NULL, NULL);
+        if (unlink(store->path) < 0 && errno != ENOENT) {
+            return -1;
+        }
+        return 0;
+    }
+
+    size_t size = strlen(SESSION_HEADER) + strlen(user) + strlen(cookie) + (token ? strlen(token) : 0) + 128;
+    size_t header = SESSION_MAGIC_SIZE + CHACHA_NONCE_SIZE;
+    if (header + size + POLY1305_TAG_SIZE > SESSION_MAX_SIZE) {
+        return -1;
+    }
+
+    uint8_t *data = malloc(header + size + POLY1305_TAG_SIZE);
+    if (!data) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    // A new nonce for every write, the key stays the same
+    memcpy(data, SESSION_MAGIC, SESSION_MAGIC_SIZE);
+    uint8_t *nonce = data + SESSION_MAGIC_SIZE;
+    if (read_random(nonce, CHACHA_NONCE_SIZE) < 0) {
+        free(data);
+        return -1;
+    }
+
+    char *text = (char *)data + header;
+    int len = snprintf(text, size, "%suser=%s\ncookie=%s\ntoken=%s\ntoken_expires=%lld\n",
+                       SESSION_HEADER, user, cookie, token ? token : "", (long long)jwt_expiry(token));
+    chacha20_xor(store->key, nonce, 1, (uint8_t *)text, (size_t)len);
+    session_tag(store, nonce, data, header + (size_t)len, data + header + (size_t)len);
+
+    // Written next to the file and renamed over it, so a crash never leaves half a session
+    char tmp_path[4096];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", store->path);
+    int fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0600);
+    if (fd < 0) {
+        free(data);
+        return -1;
+    }
+
+    size_t total = header + (size_t)len + POLY1305_TAG_SIZE;
+    int ok = write(fd, data, total) == (ssize_t)total;
+    ok = close(fd) == 0 && ok;
+    free(data);
+    if (!ok || rename(tmp_path, store->path) < 0) {
+        unlink(tmp_path);
+        return -1;
+    }
+
+    set_stored(store, user, cookie, token);
+    return 0;
+}
+
+void session_close(session_store *store)
+{
+    set_stored(store, NULL, NULL, NULL);
+}
@@ -0,0 +1,45 @@
+#ifndef SESSION_H_
+#define SESSION_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "chacha.h"
+
+#define SESSION_KEY_ENV "BOOK_SESSION_KEY"
+#define SESSION_KEY_FILE ".book_session_key"
+#define SESSION_MAGIC "BKS2"
+#define SESSION_MAGIC_SIZE (sizeof(SESSION_MAGIC) - 1)
+#define SESSION_HEADER "BKSESSION\n"
+#define SESSION_MAX_SIZE (64 * 1024)
+
+// The session (cookie and library token) kept encrypted between runs. The file holds
+// SESSION_MAGIC, a random nonce, the ChaCha20 encrypted "key=value" lines and a Poly1305
+// tag of all that before it, so a changed file is refused instead of decrypted
+typedef struct {
+    const char *path;              // session file, NULL when sessions aren't kept
+    uint8_t key[CHACHA_KEY_SIZE];  // from $BOOK_SESSION_KEY or the key file
+    char *user;                    // what the file holds now, to skip rewriting it
+    char *cookie;
+    char *token;
+} session_store;
+
+// prepares the store for path (NULL keeps no session). The key is read from $BOOK_SESSION_KEY
+// (64 hex digits) or from key_path (default ~/.book_session_key), which is created with a random
+// key if it doesn't exist and must not be readable by others. Returns -1, and keeps no session,
+// without a usable key
+int session_open(session_store *store, const char *path, const char *key_path);
+
+// reads the stored session: the user into user (size bytes), the cookie and token as new strings
+// (token NULL if there is none or its JWT expired). Returns 0 if a session was loaded, -1 if there
+// is none or the file fails its tag
+int session_load(session_store *store, char *user, size_t size, char **cookie, char **token);
+
+// stores the session if it changed since it was last loaded or stored; a NULL cookie removes the file.
+// Returns -1 if the file couldn't be written
+int session_update(session_store *store, const char *user, const char *cookie, const char *token);
+
+void session_close(session_store *store);
+
+#endif
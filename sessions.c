@@ -0,0 +1,329 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "sessions.h"
+
+// The requests of one named session, sent by an engine thread
+typedef struct {
+    connection_pool *pool;
+    sessions_action action;
+    const char *cookie;    // cookie checked by SESSIONS_START, NULL to log in right away
+    char *message;         // login, get_books or logout request, built on the main thread
+    char *check;           // answer to enter_library with the old cookie
+    char *response;        // answer to message
+    char *access;          // answer to enter_library after the login
+    const char *refusal;   // printed instead of the answers when the session sends nothing
+} session_job;
+
+void sessions_init(session_table *table)
+{
+    table->entries = NULL;
+    table->count = 0;
+    table->capacity = 0;
+    table->active = 0;
+    sessions_add(table, "");
+}
+
+void sessions_destroy(session_table *table)
+{
+    for (size_t i = 0; i < table->count; i++) {
+        free(table->entries[i].cookie);
+        free(table->entries[i].token);
+    }
+    free(table->entries);
+    table->entries = NULL;
+    table->count = 0;
+    table->capacity = 0;
+}
+
+size_t sessions_add(session_table *table, const char *name)
+{
+    for (size_t i = 0; i < table->count; i++) {
+        if (!strcmp(table->entries[i].name, name)) {
+            return i;
+        }
+    }
+
+    if (table->count == table->capacity) {
+        size_t capacity = table->capacity ? table->capacity * 2 : 8;
+        named_session *entries = realloc(table->entries, capacity * sizeof(named_session));
+        if (entries == NULL) {
+            fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+            exit(EXIT_FAILURE);
+        }
+        table->entries = entries;
+        table->capacity = capacity;
+    }
+
+    named_session *session = &table->entries[table->count];
+    memset(session, 0, sizeof(*session));
+    snprintf(session->name, sizeof(session->name), "%s", name);
+    return table->count++;
+}
+
+long sessions_load(session_table *table, const char *path)
+{
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return -1;
+    }
+
+    char *line = NULL;
+    size_t line_size = 0, line_number = 0;
+    long loaded = 0;
+
+    while (getline(&line, &line_size, file) != -1) {
+        line_number++;
+        line[strcspn(line, "\r\n")] = '\0';
+
+        // Blank lines and # comments are skipped, values may be quoted like commands
+        char *text = line + strspn(line, " \t");
+        if (*text == '\0' || *text == '#') {
+            continue;
+        }
+
+        char *words[MAX_ARGS];
+        int count = split_command_line(text, words, MAX_ARGS);
+        if (count < 2 || count > 3) {
+            fprintf(stderr, "%s:%zu: expected name username password\n", path, line_number);
+            continue;
+        }
+
+        // entries may move when the session is added
+        size_t index = sessions_add(table, words[0]);
+        named_session *session = &table->entries[index];
+        snprintf(session->user, sizeof(session->user), "%s", words[count - 2]);
+        snprintf(session->password, sizeof(session->password), "%s", words[count - 1]);
+        loaded++;
+    }
+
+    free(line);
+    fclose(file);
+    return loaded;
+}
+
+int sessions_action_of(const char *command, sessions_action *action)
+{
+    if (!strcmp(command, "session")) {
+        *action = SESSIONS_START;
+    } else if (!strcmp(command, "get_books")) {
+        *action = SESSIONS_LIST;
+    } else if (!strcmp(command, "logout")) {
+        *action = SESSIONS_END;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+// session cookie set by a login response, NULL if there is none; doesn't print, unlike
+// handle_login_response, so engine threads can use it
+static char *cookie_from_login(const char *response)
+{
+    http_response parsed;
+    char value[NMAX * 4];
+
+    if (!response || http_parse_response(response, &parsed) < 0 || parsed.status != 200 ||
+        !http_get_header(&parsed, "Set-Cookie", value, sizeof(value))) {
+        return NULL;
+    }
+
+    value[strcspn(value, ";")] = '\0';
+    return duplicate(value);
+}
+
+static char *request_access(connection_pool *pool, const char *cookie)
+{
+    char *message = build_enter_library_request((char *)cookie);
+    char *response = pool_request(pool, message);
+    free(message);
+    return response;
+}
+
+static void session_task(void *arg)
+{
+    session_job *job = arg;
+
+    if (job->action != SESSIONS_START) {
+        job->response = pool_request(job->pool, job->message);
+        return;
+    }
+
+    // A cookie the server still accepts only needs a new token, like the session command
+    if (job->cookie) {
+        job->check = request_access(job->pool, job->cookie);
+        if (!job->check || http_status(job->check) != 401) {
+            return;
+        }
+    }
+
+    // Log in and enter the library one after the other, over a kept-alive connection
+    if (job->message) {
+        job->response = pool_request(job->pool, job->message);
+        char *cookie = cookie_from_login(job->response);
+        if (cookie) {
+            job->access = request_access(job->pool, cookie);
+            free(cookie);
+        }
+    }
+}
+
+// request for session, or NULL if it sends none; refusal tells why, unless a
+// cookie can still be checked
+static char *build_session_request(named_session *session, sessions_action action, const char **refusal)
+{
+    if (action == SESSIONS_START) {
+        if (!session->password[0]) {
+            // Without credentials a session can only be checked
+            if (!session->cookie) {
+                *refusal = "No credentials for this session!";
+            }
+            return NULL;
+        }
+
+        char *info = generate_user_info(session->user, session->password);
+        char *message = compute_post_request((char *)IP, (char *)LOGIN_PATH, (char *)CONTENT_TYPE,
+                                             &info, 1, NULL, 0, 0);
+        json_free_serialized_string(info);
+        return message;
+    }
+
+    if (!session->cookie) {
+        *refusal = "User not logged in!";
+        return NULL;
+    }
+
+    if (action == SESSIONS_LIST) {
+        if (!session->token) {
+            *refusal = "Invalid token!";
+            return NULL;
+        }
+        return build_get_books_request(session->token, NULL);
+    }
+
+    return build_logout_request(session->cookie);
+}
+
+static void forget_session(named_session *session)
+{
+    free(session->cookie);
+    free(session->token);
+    session->cookie = NULL;
+    session->token = NULL;
+    session->restored = 0;
+}
+
+// prints the answers of a SESSIONS_START job and keeps the new cookie and token
+static void finish_start(named_session *session, session_job *job)
+{
+    if (job->check) {
+        if (http_status(job->check) != 401) {
+            char *token = parse_enter_library_response(job->check);
+            if (token) {
+                free(session->token);
+                session->token = token;
+                session->restored = 0;
+            }
+            return;
+        }
+
+        out_printf("The session has expired, logging in again\n");
+        forget_session(session);
+        if (!job->message) {
+            out_printf("No credentials for this session!\n");
+            return;
+        }
+    }
+
+    if (!job->response) {
+        out_printf("No response from the server\n");
+        return;
+    }
+
+    char *cookie = NULL;
+    int success = 0;
+    handle_login_response(job->response, &cookie, &success);
+    if (!success) {
+        return;
+    }
+
+    forget_session(session);
+    session->cookie = cookie;
+    session->token = job->access ? parse_enter_library_response(job->access) : NULL;
+}
+
+// prints the answer of a SESSIONS_LIST or SESSIONS_END job
+static void finish_request(named_session *session, session_job *job)
+{
+    if (!job->response) {
+        out_printf("No response from the server\n");
+        return;
+    }
+
+    if (job->action == SESSIONS_END) {
+        handle_logout_response(job->response);
+        forget_session(session);
+        return;
+    }
+
+    if (http_status(job->response) == 200) {
+        handle_books_response(job->response);
+    } else {
+        // Print the error the server sent
+        out_line(strtok(job->response, "\n"));
+    }
+}
+
+void sessions_run_all(session_table *table, sessions_action action, connection_pool *pool,
+                      task_engine *engine)
+{
+    size_t count = table->count - 1;
+    session_job *jobs = calloc(count ? count : 1, sizeof(session_job));
+    if (jobs == NULL) {
+        fprintf(stderr, "Memory allocation failed at %s:%d\n", __FILE__, __LINE__);
+        exit(EXIT_FAILURE);
+    }
+
+    // The requests are built here, since JSON is only handled on the main thread
+    engine_group group;
+    engine_group_init(&group);
+    for (size_t i = 0; i < count; i++) {
+        named_session *session = &table->entries[i + 1];
+        session_job *job = &jobs[i];
+
+        job->message = build_session_request(session, action, &job->refusal);
+        job->pool = pool;
+        job->action = action;
+        job->cookie = action == SESSIONS_START ? session->cookie : NULL;
+        if (job->message || job->cookie) {
+            engine_submit(engine, &group, session_task, job);
+        }
+    }
+    engine_group_wait(&group);
+    engine_group_destroy(&group);
+
+    // Every session's requests went out together, their answers are printed in order
+    for (size_t i = 0; i < count; i++) {
+        named_session *session = &table->entries[i + 1];
+        session_job *job = &jobs[i];
+
+        out_printf("[%s]\n", session->name);
+        if (job->refusal) {
+            out_line(job->refusal);
+        } else if (action == SESSIONS_START) {
+            finish_start(session, job);
+        } else {
+            finish_request(session, job);
+        }
+
+        free(job->message);
+        free(job->check);
+        free(job->response);
+        free(job->access);
+    }
+
+    free(jobs);
+}
@@ -0,0 +1,56 @@
+#ifndef SESSIONS_H_
+#define SESSIONS_H_
+
+#include <stddef.h>
+
+#include "functions.h"
+
+// One session of the table, with its own credentials, cookie and token
+typedef struct {
+    char name[NMAX];       // what @name routes to, "" for the default session
+    char user[NMAX];       // user of the session, "" until known
+    char password[NMAX];   // "" when no credentials were given
+    char *cookie;          // session cookie, NULL when logged out
+    char *token;           // library access token, NULL before enter_library
+    int restored;          // the session came from the session file and no request accepted it yet
+} named_session;
+
+// The sessions commands can be routed to. While a session is active its user, cookie
+// and token live in the client state, and its entry doesn't hold them
+typedef struct {
+    named_session *entries; // entries[0] is the default session of commands without @name
+    size_t count;           // sessions in entries
+    size_t capacity;        // sessions entries has room for
+    size_t active;          // session the client state holds
+} session_table;
+
+// What sessions_run_all does for each named session
+typedef enum {
+    SESSIONS_START,        // session: checks the cookie, or logs in, then enters the library
+    SESSIONS_LIST,         // get_books
+    SESSIONS_END,          // logout
+} sessions_action;
+
+// starts with only the default session, active
+void sessions_init(session_table *table);
+
+// frees the cookies and tokens kept in the entries
+void sessions_destroy(session_table *table);
+
+// returns the index of the session called name, adding a logged out one if there is none
+size_t sessions_add(session_table *table, const char *name);
+
+// adds the sessions of a file with one "name username password" per line ("username
+// password" names the session after its user); returns how many, -1 if it can't be read
+long sessions_load(session_table *table, const char *path);
+
+// checks if command can be run for every named session at once, and which action it is
+int sessions_action_of(const char *command, sessions_action *action);
+
+// runs action for every named session at once, on the engine threads over the pooled
+// connections, then prints "[name]" and the answers of each in table order; the default
+// session must be the active one
+void sessions_run_all(session_table *table, sessions_action action, connection_pool *pool,
+                      task_engine *engine);
+
+#endif
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+"""
+Generates dispatch.c: a perfect-hash table from command name to its handler
+
+The commands are listed below. After changing them run `make dispatch` (or
+`python3 tools/gen_dispatch.py > dispatch.c`) and commit the result, so the
+client builds without Python.
+"""
+
+import sys
+
+# name, session it needs, message printed when the session doesn't match,
+# values it reads in order ("..." on the last one takes the rest of the line)
+COMMANDS = [
+    ("register", "SESSION_LOGGED_OUT", "User is already logged in!", "username password"),
+    ("login", "SESSION_LOGGED_OUT", "User is already logged in!", "username password"),
+    ("get_book", "SESSION_LOGGED_IN", "User not logged in!", "ids..."),
+    ("get_books", "SESSION_LOGGED_IN", "User not logged in!", ""),
+    ("enter_library", "SESSION_LOGGED_IN", "User not logged in!", ""),
+    ("add_book", "SESSION_LOGGED_IN", "User not logged in!", "title author genre publisher page_count"),
+    ("delete_book", "SESSION_TOKEN", "User not logged in!", "id"),
+    ("logout", "SESSION_LOGGED_IN", "User already logged out!", ""),
+    ("exit", "SESSION_ANY", None, ""),
+    ("sync", "SESSION_LOGGED_IN", "User not logged in!", ""),
+    ("add_books", "SESSION_LOGGED_IN", "User not logged in!", "file"),
+    ("delete_books", "SESSION_LOGGED_IN", "User not logged in!", "ids..."),
+    ("session", "SESSION_ANY", None, "username password"),
+]
+
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+MAX_SEED = 1 << 20
+
+
+def dispatch_hash(seed, name):
+    """32-bit FNV-1a started from the seed, the same as dispatch_hash() in C"""
+    h = (FNV_OFFSET ^ seed) & 0xFFFFFFFF
+    for c in name.encode():
+        h ^= c
+        h = (h * FNV_PRIME) & 0xFFFFFFFF
+    return h
+
+
+def find_seed(names):
+    """Smallest power of two table, and a seed that puts every name in its own slot"""
+    size = 1
+    while size < len(names):
+        size *= 2
+
+    while True:
+        for seed in range(MAX_SEED):
+            slots = {dispatch_hash(seed, name) & (size - 1) for name in names}
+            if len(slots) == len(names):
+                return size, seed
+        size *= 2
+
+
+def c_string(text):
+    return "NULL" if text is None else '"%s"' % text
+
+
+def main():
+    names = [entry[0] for entry in COMMANDS]
+    if len(set(names)) != len(names):
+        sys.exit("duplicate command names")
+
+    size, seed = find_seed(names)
+    slots = {dispatch_hash(seed, name) & (size - 1): entry for entry, name in zip(COMMANDS, names)}
+
+    out = sys.stdout
+    out.write("// Generated by tools/gen_dispatch.py, edit the command list there and run make dispatch\n\n")
+    out.write("#include <stdint.h>\n#include <string.h>\n\n#include \"commands.h\"\n\n")
+    out.write("#define DISPATCH_SIZE %d\n#define DISPATCH_SEED %du\n\n" % (size, seed))
+
+    out.write("// Each command sits in the slot its name hashes to, the others are empty\n")
+    out.write("static const command commands[DISPATCH_SIZE] = {\n")
+    for slot in sorted(slots):
+        name, session, refusal, args = slots[slot]
+        words = args.split()
+        out.write('    [%d] = { "%s", command_%s, %s, %s, "%s", %d, %d },\n'
+                  % (slot, name, name, session, c_string(refusal), args, len(words),
+                     int(bool(words) and words[-1].endswith("..."))))
+    out.write("};\n\n")
+
+    out.write("// 32-bit FNV-1a started from the seed the generator found\n")
+    out.write("static uint32_t dispatch_hash(const char *name)\n{\n")
+    out.write("    uint32_t hash = %du ^ DISPATCH_SEED;\n\n" % FNV_OFFSET)
+    out.write("    for (; *name; name++) {\n")
+    out.write("        hash ^= (unsigned char)*name;\n")
+    out.write("        hash *= %du;\n" % FNV_PRIME)
+    out.write("    }\n\n    return hash;\n}\n\n")
+
+    out.write("const command *find_command(const char *name)\n{\n")
+    out.write("    const command *entry = &commands[dispatch_hash(name) & (DISPATCH_SIZE - 1)];\n\n")
+    out.write("    // Names that aren't commands land on an empty slot or on another command\n")
+    out.write("    if (!entry->name || strcmp(entry->name, name)) {\n")
+    out.write("        return NULL;\n    }\n\n    return entry;\n}\n")
+
+
+if __name__ == "__main__":
+    main()